@@ -0,0 +1,106 @@
+/***************************************************************
+*  Program:      PSburst.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star high rate burst capture
+*
+*  One channel is read back to back for a few seconds to catch
+*  inrush when something trips a fault.  The reads run in their
+*  own thread so INDI stays responsive; the driver polls
+*  isDone() from TimerHit and publishes the result.
+****************************************************************/
+
+#include "PSburst.h"
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+using namespace std;
+
+const uint8_t psBurstChannels[PS_BURST_CHANNELS] = {
+    PS_CH_IN_VOLTS, PS_CH_IN_AMPS, PS_CH_VAR_VOLTS, PS_CH_INT_VOLTS,
+    PS_CH_OUT1_AMPS, PS_CH_OUT2_AMPS, PS_CH_OUT3_AMPS, PS_CH_OUT4_AMPS,
+    PS_CH_VAR_AMPS, PS_CH_MP_AMPS, PS_CH_DEW1_AMPS, PS_CH_DEW2_AMPS
+};
+
+// "seconds,value\n"
+static const size_t ROW_SIZE = 32;
+
+PSBurst::PSBurst()
+{
+    usec.resize(PS_BURST_MAX);
+    raw.resize(PS_BURST_MAX);
+    csvBuf.resize((PS_BURST_MAX + 2) * ROW_SIZE);
+    csvBuf[0] = '\0';
+}
+
+PSBurst::~PSBurst()
+{
+    if (worker.joinable())
+        worker.join();
+}
+
+//******************************************************************
+bool PSBurst::start(PSCTL *ctl, uint8_t ch, float seconds, float thresh)
+{
+    PSCTL::PS_COMMANDS cmd;
+    uint8_t arg;
+
+    if (active || !PSCTL::adcCommand(ch, &cmd, &arg))
+        return false;
+
+    if (seconds > PS_BURST_MAX_SEC)
+        seconds = PS_BURST_MAX_SEC;
+
+    channel = ch;
+    threshold = thresh;
+    // dew currents are weighted by the duty cycle of the last poll
+    duty = psChannels[ch].duty != PS_CH_N ? ctl->chanValue[psChannels[ch].duty] : 0;
+    startTime = time(nullptr);
+    samples = 0;
+    done = false;
+    active = true;
+
+    worker = thread(&PSBurst::run, this, ctl, uint32_t(seconds * 1000));
+    return true;
+}
+
+//******************************************************************
+void PSBurst::run(PSCTL *ctl, uint32_t durationMs)
+{
+    samples = ctl->sampleADC(channel, durationMs, usec.data(), raw.data(), PS_BURST_MAX);
+    done = true;
+}
+
+//******************************************************************
+void PSBurst::finish()
+{
+    if (worker.joinable())
+        worker.join();
+    active = false;
+
+    peak = rms = overSec = rate = 0;
+    csvLen = snprintf(csvBuf.data(), csvBuf.size(), "# %s (%s) burst at %ld\nseconds,value\n",
+                      psChannels[channel].name, psChannels[channel].unit, (long)startTime);
+
+    double sumSq = 0;
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        float v = psScaleChannel(channel, raw[i], duty);
+
+        if (i == 0 || v > peak)
+            peak = v;
+        sumSq += double(v) * v;
+
+        // a sample over the threshold counts until the next one
+        if (v > threshold && i + 1 < samples)
+            overSec += (usec[i + 1] - usec[i]) / 1e6;
+
+        csvLen += snprintf(csvBuf.data() + csvLen, csvBuf.size() - csvLen, "%.6f,%.4f\n", usec[i] / 1e6, v);
+    }
+
+    if (samples > 0)
+        rms = sqrt(sumSq / samples);
+    if (samples > 1 && usec[samples - 1] > usec[0])
+        rate = (samples - 1) * 1e6 / (usec[samples - 1] - usec[0]);
+}
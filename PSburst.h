@@ -0,0 +1,74 @@
+/********************************************************
+*  Program:      PSburst.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star high rate burst capture
+*********************************************************/
+
+#pragma once
+
+#include "PScontrol.h"
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// enough for the longest burst at the hub's full rate (~1 ms per read)
+#define PS_BURST_MAX_SEC    30
+#define PS_BURST_MAX        (PS_BURST_MAX_SEC * 1000)
+
+// channels that can be burst sampled (the ADC volts/amps channels)
+#define PS_BURST_CHANNELS   12
+extern const uint8_t psBurstChannels[PS_BURST_CHANNELS];
+
+class PSBurst
+{
+    public:
+        PSBurst();
+        ~PSBurst();
+
+        /**
+         * @brief start Begin sampling a channel in a worker thread
+         * @param ctl device, its other commands are taken between samples
+         * @param ch PS_CHANNEL, one of the ADC volts/amps channels
+         * @param seconds burst length, up to PS_BURST_MAX_SEC
+         * @param threshold level for the time over threshold statistic
+         * @return False if a burst is already running or the channel can't be sampled
+         */
+        bool    start(PSCTL *ctl, uint8_t ch, float seconds, float threshold);
+
+        // true from start() until finish()
+        bool    isActive() { return active; }
+        // the worker is done, call finish() from the driver thread
+        bool    isDone() { return done.load(); }
+        // joins the worker, computes the statistics and the CSV
+        void    finish();
+
+        uint8_t  channel { PS_CH_N };
+        uint32_t samples { 0 };
+        float    peak { 0 };
+        float    rms { 0 };
+        float    overSec { 0 };
+        float    rate { 0 };
+
+        // "seconds,value" rows, valid after finish()
+        const char *csv() { return csvBuf.data(); }
+        size_t   csvLen { 0 };
+
+    private:
+        void    run(PSCTL *ctl, uint32_t durationMs);
+
+        thread   worker;
+        atomic<bool> done { false };
+        bool     active { false };
+        float    threshold { 0 };
+        float    duty { 0 };
+        time_t   startTime { 0 };
+
+        // sized once, a burst never allocates
+        vector<uint32_t> usec;
+        vector<uint16_t> raw;
+        vector<char>     csvBuf;
+};
@@ -0,0 +1,61 @@
+/***************************************************************
+*  Program:      PSchannels.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star telemetry channel table
+****************************************************************/
+
+#include "PSchannels.h"
+#include <string.h>
+#include <strings.h>
+
+// scaling follows the Power*Star ADC documentation
+const psChannelInfo psChannels[PS_CH_N] =
+{
+    { "IN_VOLTS",     "V", 0.014695, 0,  0, PS_CH_N },
+    { "IN_AMPS",      "A", 0.001780, 0,  0, PS_CH_N },
+    { "VAR_VOLTS",    "V", 0.012813, 0,  0, PS_CH_N },
+    { "INT_VOLTS",    "V", 0.004004, 0,  0, PS_CH_N },
+    { "OUT1_AMPS",    "A", 0.075690, 0,  0, PS_CH_N },
+    { "OUT2_AMPS",    "A", 0.075690, 0,  0, PS_CH_N },
+    { "OUT3_AMPS",    "A", 0.010111, 0,  0, PS_CH_N },
+    { "OUT4_AMPS",    "A", 0.010111, 0,  0, PS_CH_N },
+    { "VAR_AMPS",     "A", 0.010111, 0,  0, PS_CH_N },
+    { "MP_AMPS",      "A", 0.010111, 0,  0, PS_CH_N },
+    { "DEW1_AMPS",    "A", 0.010111, 0,  0, PS_CH_DEW1_PERCENT },
+    { "DEW2_AMPS",    "A", 0.010111, 0,  0, PS_CH_DEW2_PERCENT },
+    { "DEW1_PERCENT", "%", 1,        0,  0, PS_CH_N },
+    { "DEW2_PERCENT", "%", 1,        0,  0, PS_CH_N },
+    { "TEMP",         "F", 1.8,      32, 8, PS_CH_N },   // whole degrees C in the high byte
+    { "HUM",          "%", 1,        0,  0, PS_CH_N },
+};
+
+//******************************************************************
+uint8_t psFindChannel(const char *name)
+{
+    for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+    {
+        if (strcasecmp(name, psChannels[ch].name) == 0)
+            return ch;
+    }
+    return PS_CH_N;
+}
+
+//******************************************************************
+float psScaleChannel(uint8_t ch, uint16_t raw, float dutyPercent)
+{
+    const psChannelInfo &info = psChannels[ch];
+    float value = (raw >> info.shift) * info.scale + info.offset;
+    
+    if (info.duty != PS_CH_N)
+        value = value / 100 * dutyPercent;
+    
+    return value;
+}
+
+//******************************************************************
+float psTempC(uint16_t raw)
+{
+    // signed 8.8 fixed point
+    return int16_t(raw) / 256.0f;
+}
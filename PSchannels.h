@@ -0,0 +1,54 @@
+/********************************************************
+*  Program:      PSchannels.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star telemetry channel table
+*********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+// Telemetry channels sampled by PSCTL::getStatus()
+// (order is part of the history/journal formats, only append)
+typedef enum {     PS_CH_IN_VOLTS,
+                   PS_CH_IN_AMPS,
+                   PS_CH_VAR_VOLTS,
+                   PS_CH_INT_VOLTS,
+                   PS_CH_OUT1_AMPS,
+                   PS_CH_OUT2_AMPS,
+                   PS_CH_OUT3_AMPS,
+                   PS_CH_OUT4_AMPS,
+                   PS_CH_VAR_AMPS,
+                   PS_CH_MP_AMPS,
+                   PS_CH_DEW1_AMPS,
+                   PS_CH_DEW2_AMPS,
+                   PS_CH_DEW1_PERCENT,
+                   PS_CH_DEW2_PERCENT,
+                   PS_CH_TEMP,
+                   PS_CH_HUM,
+                   PS_CH_N
+} PS_CHANNEL;
+
+// value = ((raw >> shift) * scale + offset), then weighted by the
+// percent in the 'duty' channel when that is not PS_CH_N
+typedef struct {
+            const char *name;          // used in queries and exports
+            const char *unit;
+            float    scale;
+            float    offset;
+            uint8_t  shift;
+            uint8_t  duty;
+} psChannelInfo;
+
+extern const psChannelInfo psChannels[PS_CH_N];
+
+// returns PS_CH_N if the name is not known
+uint8_t psFindChannel(const char *name);
+
+// convert raw counts to units, dutyPercent is ignored unless the channel has a duty channel
+float   psScaleChannel(uint8_t ch, uint16_t raw, float dutyPercent);
+
+// PS_CH_TEMP in C to the sensor's 1/256 degree, the channel itself is
+// whole degrees
+float   psTempC(uint16_t raw);
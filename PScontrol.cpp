@@ -6,6 +6,7 @@
 ****************************************************************/
 
 #include "PScontrol.h"
+#include "PStrace.h"
 //#include <boost/algorithm/string.hpp>
 
 using namespace std;
@@ -13,7 +14,7 @@ using namespace std;
 
 static std::unique_ptr<PSCTL> psctl(new PSCTL());
 
-PSCTL::PSCTL() {handle = nullptr;}
+PSCTL::PSCTL() : transport(psCreateTransport()) {}
 
 /**
 const std::map<PS_MOTOR, std::string> PSCTL::MotorMap =
@@ -50,14 +51,12 @@ const std::map<PS_MOTOR, std::string> PSCTL::MotorMap =
 //******************************************************************
 bool PSCTL::Connect()
 {
-    handle = hid_open(0x4D8, 0xEC42, nullptr);
-
-    if (handle == nullptr)
-        return false;
-    
-    // Close the USB (we only connected to test)
-    hid_close(handle);
-    hid_exit();
+    // the session is kept for the commands that follow
+    {
+        lock_guard<mutex> lock(hidMutex);
+        if (!transport->isOpen() && !transport->open())
+            return false;
+    }
     
     unLockFocusMtr();
 
@@ -69,6 +68,16 @@ bool PSCTL::Disconnect()
 {
     lockFocusMtr();
     isConnected = false;
+    
+    // the hub may be changed by something else before we're back
+    appliedKnown = false;
+    brakingKnown = false;
+    for (int c = 0; c < 3; c++)
+        dewWritten[c] = dewCommitted[c] = -1;
+    
+    // let go of the hub
+    lock_guard<mutex> lock(hidMutex);
+    transport->close();
     return true;
 }
 
@@ -80,6 +89,9 @@ bool PSCTL::Disconnect()
 // Reports whether ports or usb are on or off
 bool PSCTL::getStatus()
 {
+    PS_TRACE_SPAN("getStatus");
+    PS_TRACE_PHASE(phase, "getStatus ports");
+    
     // Port Status
     response = hidCMD(PS_PORT_STATUS, 0x00, 0x00, 3);
         
@@ -98,61 +110,78 @@ bool PSCTL::getStatus()
     statusMap["USB6"].state = (response[2] & 0x20);
     
     // Dew
+    PS_TRACE_NEXT(phase, "getStatus dew");
     response = hidCMD(PS_DEW_STATUS, 0x00, 0x00, 3);
+    setChannel(PS_CH_DEW1_PERCENT, response[2]);
     statusMap["Dew1"].setting = response[2];
     statusMap["Dew1"].state = (response[2] > 0);  // TODO change to independent percent and on/off
     
     response = hidCMD(PS_DEW_STATUS, 0x01, 0x00, 3);
+    setChannel(PS_CH_DEW2_PERCENT, response[2]);
     statusMap["Dew2"].setting = response[2];
     statusMap["Dew2"].state = (response[2] > 0);  // TODO see above
 
     // Voltages
+    PS_TRACE_NEXT(phase, "getStatus volts");
     response = hidCMD(PS_VOLTS, 0, 0x00, 3);
-    float INvolts = (response[2] * 256 + response[1]) * 0.014695;
-    statusMap["IN"].levels = INvolts;
+    setChannel(PS_CH_IN_VOLTS, response[2] * 256 + response[1]);
+    statusMap["IN"].levels = chanValue[PS_CH_IN_VOLTS];
     
     response = hidCMD(PS_VOLTS, 1, 0x00, 3);
-    float VARvolts = (response[2] * 256 + response[1]) * 0.012813;
-    statusMap["Var"].levels = VARvolts;
+    setChannel(PS_CH_VAR_VOLTS, response[2] * 256 + response[1]);
+    statusMap["Var"].levels = chanValue[PS_CH_VAR_VOLTS];
     
     response = hidCMD(PS_VOLTS, 2, 0x00, 3);
-    float INTvolts = (response[2] * 256 + response[1]) * 0.004004;
-    statusMap["Int"].levels = INTvolts;
+    setChannel(PS_CH_INT_VOLTS, response[2] * 256 + response[1]);
+    statusMap["Int"].levels = chanValue[PS_CH_INT_VOLTS];
     
     // Port Currents
+    PS_TRACE_NEXT(phase, "getStatus amps");
     response = hidCMD(PS_CURRENT, 0, 0x00, 3);
-    statusMap["Out1"].current = (response[2] * 256 + response[1]) * 0.075690;
+    setChannel(PS_CH_OUT1_AMPS, response[2] * 256 + response[1]);
+    statusMap["Out1"].current = chanValue[PS_CH_OUT1_AMPS];
     response = hidCMD(PS_CURRENT, 1, 0x00, 3);
-    statusMap["Out2"].current = (response[2] * 256 + response[1]) * 0.075690;
+    setChannel(PS_CH_OUT2_AMPS, response[2] * 256 + response[1]);
+    statusMap["Out2"].current = chanValue[PS_CH_OUT2_AMPS];
     response = hidCMD(PS_CURRENT, 2, 0x00, 3);
-    statusMap["Out3"].current = (response[2] * 256 + response[1]) * 0.010111;
+    setChannel(PS_CH_OUT3_AMPS, response[2] * 256 + response[1]);
+    statusMap["Out3"].current = chanValue[PS_CH_OUT3_AMPS];
     response = hidCMD(PS_CURRENT, 3, 0x00, 3);
-    statusMap["Out4"].current = (response[2] * 256 + response[1]) * 0.010111;
+    setChannel(PS_CH_OUT4_AMPS, response[2] * 256 + response[1]);
+    statusMap["Out4"].current = chanValue[PS_CH_OUT4_AMPS];
     
-    //Dew
+    //Dew (weighted by the dew % read above)
     response = hidCMD(PS_CURRENT, 4, 0x00, 3);
-    statusMap["Dew1"].current = ((response[2] * 256 + response[1]) * 0.010111) / 100  * statusMap["Dew1"].setting;
+    setChannel(PS_CH_DEW1_AMPS, response[2] * 256 + response[1]);
+    statusMap["Dew1"].current = chanValue[PS_CH_DEW1_AMPS];
     response = hidCMD(PS_CURRENT, 5, 0x00, 3);
-    statusMap["Dew2"].current = ((response[2] * 256 + response[1]) * 0.010111) / 100 * statusMap["Dew2"].setting;
+    setChannel(PS_CH_DEW2_AMPS, response[2] * 256 + response[1]);
+    statusMap["Dew2"].current = chanValue[PS_CH_DEW2_AMPS];
     
     response = hidCMD(PS_CURRENT, 6, 0x00, 3);
-    statusMap["Var"].current = (response[2] * 256 + response[1]) * 0.010111;
+    setChannel(PS_CH_VAR_AMPS, response[2] * 256 + response[1]);
+    statusMap["Var"].current = chanValue[PS_CH_VAR_AMPS];
     response = hidCMD(PS_CURRENT, 7, 0x00, 3);
-    statusMap["MP"].current = (response[2] * 256 + response[1]) * 0.010111;
+    setChannel(PS_CH_MP_AMPS, response[2] * 256 + response[1]);
+    statusMap["MP"].current = chanValue[PS_CH_MP_AMPS];
 
     response = hidCMD(PS_CURRENT, 8, 0x00, 3);
-    statusMap["IN"].current = (response[2] * 256 + response[1]) * 0.001780;
+    setChannel(PS_CH_IN_AMPS, response[2] * 256 + response[1]);
+    statusMap["IN"].current = chanValue[PS_CH_IN_AMPS];
     
     // Temperature
+    PS_TRACE_NEXT(phase, "getStatus weather");
     response = hidCMD(PS_GET_WEATHER, PS_TEMP, 0x00, 3);
-    float curTemp = ((response[2] * 256 + response[1]) / 256) * 9 / 5.0 + 32; // in F
-    statusMap["Temp"].levels = curTemp;
+    setChannel(PS_CH_TEMP, response[2] * 256 + response[1]);
+    statusMap["Temp"].levels = chanValue[PS_CH_TEMP];  // in F
 
     // Humidity
     response = hidCMD(PS_GET_WEATHER, PS_HUM, 0x00, 3);
-    statusMap["Hum"].levels = response[1];
+    setChannel(PS_CH_HUM, response[1]);
+    statusMap["Hum"].levels = chanValue[PS_CH_HUM];
 
     // autoboot
+    PS_TRACE_NEXT(phase, "getStatus settings");
     response = hidCMD(PS_GET_AUTO, 0x00, 0x00, 3);
     
     statusMap["Out1"].autoboot = (response[1] & 0x01);
@@ -183,6 +212,16 @@ bool PSCTL::getStatus()
     return true;
 }
 
+//******************************************************************
+// Store raw ADC counts and the scaled value for a telemetry channel
+void PSCTL::setChannel(uint8_t ch, uint16_t raw)
+{
+    uint8_t duty = psChannels[ch].duty;
+    
+    chanRaw[ch] = raw;
+    chanValue[ch] = psScaleChannel(ch, raw, duty != PS_CH_N ? chanValue[duty] : 0);
+}
+
 //******************************************************************
 void PSCTL::clearFaultStatus()
 {    
@@ -306,7 +345,7 @@ void PSCTL::setUserLimitStatus(float usrlimit[12])
 }
 
 //***************************************************************
-PowerStarProfile PSCTL::getProfileStatus() 
+PowerStarProfile PSCTL::getProfileStatus(bool afterStatus) 
 {
         // PowerStarProfile =   profile Type (0:hsm, 1:pdms, 2:uni12, 3:custom, 4:unset) 
         //                      backlash 
@@ -336,7 +375,7 @@ PowerStarProfile PSCTL::getProfileStatus()
     
     // Step Period
     response = hidCMD(PS_GET_SPERIOD, 0, 0, 2);
-    actProfile.stepPeriod = response[1] / 10;
+    actProfile.stepPeriod = response[1] / 10.0;
     
     // Curent and Max focuser positions
     getPosition(&actProfile.curPosition, PS_GET_POS);
@@ -349,7 +388,7 @@ PowerStarProfile PSCTL::getProfileStatus()
     
     // Hysterisis
     response = hidCMD(PS_GET_HYS, 0, 0, 2);
-    actProfile.tempHysterisis = response[1] / 10;
+    actProfile.tempHysterisis = response[1] / 10.0;
     
     // Temperature compensation (which sensor to use)
     response = hidCMD(PS_GET_TCOMP, 0, 0, 2);
@@ -361,10 +400,18 @@ PowerStarProfile PSCTL::getProfileStatus()
     
     //actProfile.disablePermFocus = 0;  //ATTENTION maybe not implement this here ??
     
-    // Motor type 
-    response = hidCMD(PS_GET_MTR_LED, 0, 0, 3);
-    actProfile.motorType = response[2];  //0:unipolar, 1:bipolar
+    // Motor type, the same register getStatus() reads for the multiport
+    if (afterStatus)
+        actProfile.motorType = statusMap["FM"].setting;
+    else {
+        response = hidCMD(PS_GET_MTR_LED, 0, 0, 3);
+        actProfile.motorType = response[2];  //0:unipolar, 1:bipolar
+    }
 
+    // what setProfileStatus compares against (braking can't be read back)
+    actProfile.motorBraking = applied.motorBraking;
+    applied = actProfile;
+    appliedKnown = true;
     
     return actProfile;
 }
@@ -389,61 +436,106 @@ bool PSCTL::setProfileStatus(PowerStarProfile psProfile)
     
     
     
-    // Set reverse motor
-    response = hidCMD(PS_SET_MTRPOL, psProfile.reverseMtr, 0x00, 2);
-    if (response[1] == 0xff)
-        return false;
+    // only what differs from the hub's profile is written, all of it
+    // when that isn't known (not read yet, reconnected, a failed write)
+    bool all = !appliedKnown;
+    bool changed = false;
+    
+    // Reverse motor
+    if (all || psProfile.reverseMtr != applied.reverseMtr) {
+        response = hidCMD(PS_SET_MTRPOL, psProfile.reverseMtr, 0x00, 2);
+        if (response[1] == 0xff)
+            return profileFailed();
+        changed = true;
+    }
     
     // Backlash amount and preferred direction
-    hidCMD(PS_SET_BACKLASH, psProfile.backlash, psProfile.prefDir, 3);
+    if (all || psProfile.backlash != applied.backlash || psProfile.prefDir != applied.prefDir) {
+        hidCMD(PS_SET_BACKLASH, psProfile.backlash, psProfile.prefDir, 3);
+        changed = true;
+    }
     
     // Motor idle and drive current
-    response = hidCMD(PS_SET_MTRCUR, psProfile.idleMtrCurrent, psProfile.driveMtrCurrent, 3);
-    if (response[1] == 0xff || response[2] == 0xff)
-        return false;
+    if (all || psProfile.idleMtrCurrent != applied.idleMtrCurrent || psProfile.driveMtrCurrent != applied.driveMtrCurrent) {
+        response = hidCMD(PS_SET_MTRCUR, psProfile.idleMtrCurrent, psProfile.driveMtrCurrent, 3);
+        if (response[1] == 0xff || response[2] == 0xff)
+            return profileFailed();
+        changed = true;
+    }
     
     // Step Period
-    response = hidCMD(PS_SET_SPERIOD, (uint8_t)(psProfile.stepPeriod * 10), 0x00, 2);
-    if (response[1] == 0xff)
-        return false;
+    if (all || (uint8_t)(psProfile.stepPeriod * 10) != (uint8_t)(applied.stepPeriod * 10)) {
+        response = hidCMD(PS_SET_SPERIOD, (uint8_t)(psProfile.stepPeriod * 10), 0x00, 2);
+        if (response[1] == 0xff)
+            return profileFailed();
+        changed = true;
+    }
    
     // focus min/max not to be set here
  
-    // temperature coefficient
+    // temperature coefficient, 8.8
     uint8_t hbyte = (psProfile.tempCoef);
     uint8_t lbyte = (psProfile.tempCoef - hbyte) * 256;
-    hidCMD(PS_SET_TMPCOEF, lbyte, hbyte, 3);
+    uint8_t wasHbyte = (applied.tempCoef);
+    uint8_t wasLbyte = (applied.tempCoef - wasHbyte) * 256;
+    if (all || hbyte != wasHbyte || lbyte != wasLbyte) {
+        hidCMD(PS_SET_TMPCOEF, lbyte, hbyte, 3);
+        changed = true;
+    }
     
     // hysteresis
-    response = hidCMD(PS_SET_HYS, (uint8_t)(psProfile.tempHysterisis * 10), 0x00, 2);
-    if (response[1] == 0xff)
-        return false;
+    if (all || (uint8_t)(psProfile.tempHysterisis * 10) != (uint8_t)(applied.tempHysterisis * 10)) {
+        response = hidCMD(PS_SET_HYS, (uint8_t)(psProfile.tempHysterisis * 10), 0x00, 2);
+        if (response[1] == 0xff)
+            return profileFailed();
+        changed = true;
+    }
 
     // temperature compensation - which sensor to use 0=disabled, 1=motor, 2=env
-    response = hidCMD(PS_SET_TCOMP, psProfile.tempSensor, 0x00, 2);
-    if (response[1] == 0xff)
-        return false;
-    
-    // reverse motor
-    response = hidCMD(PS_SET_MTRPOL, psProfile.reverseMtr, 0, 2);
-    if (response[1] == 0xff)
-        return false;
+    if (all || psProfile.tempSensor != applied.tempSensor) {
+        response = hidCMD(PS_SET_TCOMP, psProfile.tempSensor, 0x00, 2);
+        if (response[1] == 0xff)
+            return profileFailed();
+        changed = true;
+    }
     
     // Set Motor Type
     // need to read in status first, then set mtr type and put back
     //keep response[1] as that sets Mp and LED modes
-    response = hidCMD(PS_GET_MTR_LED, 0x00, 0x00, 3);
-    response = hidCMD(PS_SET_MTR_LED, response[1], psProfile.motorType, 3);
-    if (response[1] == 0xff)
-        return false;
+    if (all || psProfile.motorType != applied.motorType) {
+        response = hidCMD(PS_GET_MTR_LED, 0x00, 0x00, 3);
+        response = hidCMD(PS_SET_MTR_LED, response[1], psProfile.motorType, 3);
+        if (response[1] == 0xff)
+            return profileFailed();
+        changed = true;
+    }
     
-    // motor breaking
-    if ( ! saveDewPwmFault(psProfile))
-        return false;
+    bool braking = !brakingKnown || psProfile.motorBraking != applied.motorBraking;
+    applied = psProfile;
+    appliedKnown = true;
+    
+    // motor breaking, and the commit to nvm, only when something changed
+    if (changed || braking || nvmDirty) {
+        if ( ! saveDewPwmFault(psProfile))
+            return profileFailed();
+        brakingKnown = true;
+        nvmDirty = false;
+        for (int c = 0; c < 3; c++)
+            dewCommitted[c] = dewWritten[c];
+    }
     
     return true;
 }
 
+//***************************************************************
+// Part of a profile may have been written, write all of it next time
+bool PSCTL::profileFailed()
+{
+    appliedKnown = false;
+    brakingKnown = false;
+    return false;
+}
+
 //******************************************************************
 // Set Devices
 //******************************************************************
@@ -484,12 +576,17 @@ bool PSCTL::setPowerState(const string &device, const string &action)
 }
 
 //**************************************************************
-bool PSCTL::setDew(uint8_t channel, uint8_t percent)
+bool PSCTL::setDew(uint8_t channel, uint8_t percent, bool keep)
 {
     response = hidCMD(PS_DEW_CTL, channel, percent, 3);
     if (response[2] == 0xff) {
         return false;
     }
+    if (channel < 3) {
+        dewWritten[channel] = percent;
+        if (keep && dewCommitted[channel] != percent)
+            nvmDirty = true;
+    }
     return true;
 }
 
@@ -497,7 +594,10 @@ bool PSCTL::setDew(uint8_t channel, uint8_t percent)
 bool PSCTL::setUlimit(uint8_t device, uint8_t adcLimit)
 {
     response = hidCMD(PS_SET_ULIMIT, device, adcLimit, 3);
-
+    if (response[0] == 0xff || response[2] == 0xff) {
+        return false;
+    }
+    nvmDirty = true;
     return true;
 }
 
@@ -518,6 +618,7 @@ bool PSCTL::setPWM(uint16_t pwmamt)
     if (response[2] == 0xff) {
         return false;
     }
+    nvmDirty = true;
     return true;
 }
 
@@ -607,6 +708,7 @@ bool PSCTL::setMultiPort(uint8_t MPtype)
     if (response[1] == 0xff) {
         return false;
     }
+    nvmDirty = true;
     return true;
 }
     
@@ -623,6 +725,7 @@ bool PSCTL::setLED(uint8_t brightness)
     if (response[1] == 0xff) {
         return false;
     }
+    nvmDirty = true;
     return true;
 }
     
@@ -698,38 +801,111 @@ uint8_t* PSCTL::hidCMD(PS_COMMANDS hcmd, uint8_t hidArg1, uint8_t hidArg2, int n
     hidcmd[1] = hidArg1;
     hidcmd[2] = hidArg2;
     
-    handle = hid_open(0x4D8, 0xEC42, nullptr);
-    if (handle == nullptr) {
+    // the span includes waiting for a burst sample to let go of the hub
+    PS_TRACE_SPAN(psOpcodeName(hcmd));
+    lock_guard<mutex> lock(hidMutex);
+    
+    PSDiag &diag = psDiag();
+    auto start = chrono::steady_clock::now();
+    
+    // the session stays open between commands, (re)open it when needed
+    // opening can fail while the hub is busy, nothing has been sent yet so try again
+    bool opened = transport->isOpen() || transport->open();
+    for (int i = 0; !opened && i < PS_OPEN_RETRIES; i++)
+    {
+        diag.retry(hcmd);
+        usleep(PS_OPEN_RETRY_US);
+        opened = transport->open();
+    }
+    
+    if (!opened)
         hRes[0] = 0xff;
-        hid_close(handle);
-        hid_exit();
-        return hRes;
+    else if (transport->write(hidcmd, numCmd) < 0)
+        hRes[0] = 0xff;
+    else
+    {
+        rc = transport->read(hRes, 3, PS_TIMEOUT);
+        if (rc == 0)
+            diag.timeout(hcmd);
+        // a timeout leaves the last reply in hRes, don't hand that back
+        if (rc <= 0)
+            hRes[0] = 0xff;
     }
+    
+    // after a failure start the next command on a fresh session
+    if (opened && hRes[0] == 0xff)
+        transport->close();
+    
+    diag.record(hcmd, chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count());
+    if (hRes[0] == 0xff)
+        diag.error(hcmd);
+    
+    return hRes;
+}
 
-    rc = hid_write(handle, hidcmd, numCmd);
-
-    if (rc < 0)
+//******************************************************************
+bool PSCTL::adcCommand(uint8_t ch, PS_COMMANDS *cmd, uint8_t *arg)
+{
+    switch (ch)
     {
-        hRes[0] = 0xff;
-        hid_close(handle);
-        hid_exit();
-        return hRes;
+        case PS_CH_IN_VOLTS:  *cmd = PS_VOLTS;   *arg = 0; return true;
+        case PS_CH_VAR_VOLTS: *cmd = PS_VOLTS;   *arg = 1; return true;
+        case PS_CH_INT_VOLTS: *cmd = PS_VOLTS;   *arg = 2; return true;
+        case PS_CH_OUT1_AMPS: *cmd = PS_CURRENT; *arg = 0; return true;
+        case PS_CH_OUT2_AMPS: *cmd = PS_CURRENT; *arg = 1; return true;
+        case PS_CH_OUT3_AMPS: *cmd = PS_CURRENT; *arg = 2; return true;
+        case PS_CH_OUT4_AMPS: *cmd = PS_CURRENT; *arg = 3; return true;
+        case PS_CH_DEW1_AMPS: *cmd = PS_CURRENT; *arg = 4; return true;
+        case PS_CH_DEW2_AMPS: *cmd = PS_CURRENT; *arg = 5; return true;
+        case PS_CH_VAR_AMPS:  *cmd = PS_CURRENT; *arg = 6; return true;
+        case PS_CH_MP_AMPS:   *cmd = PS_CURRENT; *arg = 7; return true;
+        case PS_CH_IN_AMPS:   *cmd = PS_CURRENT; *arg = 8; return true;
+        default:
+            return false;
     }
+}
 
-    rc = hid_read_timeout(handle, hRes, 3, PS_TIMEOUT);
-    if (rc < 0)
+//******************************************************************
+// Burst read of one ADC channel, the device stays open for the whole run
+// but is only held for each sample, so a command can go in between
+uint32_t PSCTL::sampleADC(uint8_t ch, uint32_t durationMs, uint32_t *usec, uint16_t *raw, uint32_t maxSamples)
+{
+    PS_COMMANDS cmd;
+    uint8_t hidcmd[3] = {0};
+    uint8_t hRes[3] = {0};
+    uint32_t count = 0;
+    
+    if (!adcCommand(ch, &cmd, &hidcmd[1]))
+        return 0;
+    hidcmd[0] = cmd;
+    
+    PS_TRACE_SPAN("sampleADC");
+    
+    auto start = chrono::steady_clock::now();
+    while (count < maxSamples)
     {
-        hRes[0] = 0xff;
-        hid_close(handle);
-        hid_exit();
-        return hRes;
+        uint32_t elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        if (elapsed >= durationMs * 1000)
+            break;
+        
+        // a command in between may have closed the session after a failure
+        lock_guard<mutex> lock(hidMutex);
+        if (!transport->isOpen() && !transport->open())
+            break;
+        
+        if (transport->write(hidcmd, 3) < 0 || transport->read(hRes, 3, PS_TIMEOUT) <= 0)
+        {
+            // start the next command on a fresh session
+            transport->close();
+            break;
+        }
+        
+        usec[count] = elapsed;
+        raw[count] = hRes[2] * 256 + hRes[1];
+        count++;
     }
     
-    // Close out the USB
-    hid_close(handle);
-    hid_exit();
-    
-    return hRes;
+    return count;
 }
 
 //******************************************************************
@@ -746,6 +922,12 @@ bool PSCTL::MoveAbsFocuser(uint32_t targetTicks)
 
     targetPosition = targetTicks;
     
+    // the move (or its backlash overshoot) may cross a 65536 step boundary
+    uint32_t lo = targetTicks > 255 ? targetTicks - 255 : 0;
+    uint32_t hi = targetTicks + 255;
+    if (!posHighKnown[PS_ABS] || (lo >> 16) != posHigh[PS_ABS] || (hi >> 16) != posHigh[PS_ABS])
+        posMayCross = true;
+    
     response = hidCMD(PS_MTR_CMD, PS_GOTO, 0x00, 2);
 
     if (response[1] == 0xff)
@@ -762,7 +944,7 @@ bool PSCTL::setPosition(uint32_t ticks)
 
     // 20 bit resolution position. 4 high bits + 16 lower bits
     // Send 4 high bits first
-    setTicks1 = (ticks & 0x40000) >> 16;
+    setTicks1 = (ticks >> 16) & 0x0F;
 
 
     response = hidCMD(PS_SET_HBITS, setTicks1, 0x00, 2);
@@ -791,7 +973,6 @@ bool PSCTL::setPosition(uint32_t ticks)
  */
 bool PSCTL::getPosition(uint32_t *ticks, uint8_t cmdCode)
 {
-    uint32_t pos = 0;
     uint8_t posType;
 
     // 20 bit resolution position. 4 high bits + 16 lower bits
@@ -800,23 +981,50 @@ bool PSCTL::getPosition(uint32_t *ticks, uint8_t cmdCode)
     else
         posType = PS_MAX; //get max position
 
-    response = hidCMD(PS_GET_HBITS, posType, 0x00, 2);
+    // The high bits only change when the position crosses a 65536 step
+    // boundary, read them when unknown, during a move that may cross one
+    // or when the motor runs close to one (temperature compensation,
+    // hand controller)
+    bool nearEdge = (lastMotion == PS_MTR_OUT && lastPosLow > 0xFFFF - PS_POS_EDGE) ||
+                    (lastMotion == PS_MTR_IN && lastPosLow < PS_POS_EDGE);
+    bool fresh = !posHighKnown[posType] || (posType == PS_ABS && (posMayCross || nearEdge));
 
-    // Store 4 high bits part of a 20 bit number
-    pos = response[1] << 16;
+    if (fresh)
+    {
+        response = hidCMD(PS_GET_HBITS, posType, 0x00, 2);
+        if (response[0] == 0xff)
+            return false;
+        posHigh[posType] = response[1] & 0x0F;
+        posHighKnown[posType] = true;
+    }
 
     // Get 16 lower bits
-    if (cmdCode == PS_GET_POS)
-        posType = PS_ABS; //get abs position
-    else
-        posType = PS_MAX; //get max position
-
     response = hidCMD(PS_GET_POS, posType, 0x00, 3);
+    if (response[0] == 0xff)
+        return false;
 
     // response[1] is lower byte and response[2] is high byte. Combine and add to ticks.
-    pos |= response[1] | response[2] << 8;
+    uint16_t low = response[1] | response[2] << 8;
 
-    *ticks = pos;
+    if (posType == PS_ABS)
+    {
+        // moved further than half a block since the last read (hand
+        // controller, temperature compensation): assume it wrapped
+        uint16_t jump = low > lastPosLow ? low - lastPosLow : lastPosLow - low;
+        if (!fresh && jump > 0x8000)
+        {
+            response = hidCMD(PS_GET_HBITS, posType, 0x00, 2);
+            if (response[0] == 0xff)
+            {
+                forgetPosHigh(PS_ABS);
+                return false;
+            }
+            posHigh[posType] = response[1] & 0x0F;
+        }
+        lastPosLow = low;
+    }
+
+    *ticks = uint32_t(posHigh[posType]) << 16 | low;
 
     return true;
 }
@@ -853,6 +1061,14 @@ uint8_t PSCTL::getFocusStatus()
     if (response[1] > 5)
         response[1] = 4;
 
+    // getPosition watches for boundary crossings while moving,
+    // once stopped one more read settles the high bits
+    lastMotion = response[1];
+    if (posMayCross && lastMotion != PS_MTR_IN && lastMotion != PS_MTR_OUT && response[0] != 0xff)
+    {
+        posMayCross = false;
+        forgetPosHigh(PS_ABS);
+    }
     return response[1];
 }
 
@@ -860,6 +1076,7 @@ uint8_t PSCTL::getFocusStatus()
 bool PSCTL::AbortFocuser()
 {    
     uint8_t* hres = hidCMD(PS_MTR_CMD, PS_HALT, 0x00, 2);
+    forgetPosHigh(PS_ABS);
     if (hres[1] == 0)
         return true;
     else
@@ -877,6 +1094,7 @@ bool PSCTL::SyncFocuser(uint32_t ticks)
     simPosition = ticks;
 
     uint8_t* hrc = hidCMD(PS_MTR_CMD, PS_CMD_POS, 0x00, 2);
+    forgetPosHigh(PS_ABS);
 
     if (hrc[1] == 0)
         return true;
@@ -894,6 +1112,7 @@ bool PSCTL::SetFocuserMaxPosition(uint32_t ticks)
         return false;
     
     uint8_t* hrc = hidCMD(PS_MTR_CMD, PS_CMD_MAX, 0x00, 2);
+    forgetPosHigh(PS_MAX);
 
     if (hrc[1] == 0)
         return true;
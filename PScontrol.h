@@ -7,13 +7,17 @@
 
 #pragma once
 
-#include "hidapi.h"
+#include "PStransport.h"
+#include "PSchannels.h"
+#include "PSdiag.h"
 #include <map>
 #include <vector>
 #include <sys/file.h>
 #include <stdint.h>
 #include <string>
 #include <unistd.h>
+#include <mutex>
+#include <memory>
 #include <bits/stdc++.h> 
 
 using namespace std;
@@ -140,6 +144,10 @@ class PSCTL
         map <string, statusData> statusMap;
         map <string, statusData> :: iterator itr;
         
+        // latest getStatus() readings indexed by PS_CHANNEL
+        float    chanValue[PS_CH_N] {};
+        uint16_t chanRaw[PS_CH_N] {};
+        
         const char *getDefaultName();
         bool    initProperties();
         //void    SetTimer(int POLLMS);
@@ -159,9 +167,11 @@ class PSCTL
         uint8_t  getDew(uint8_t device);
         uint32_t getFaultStatus(uint16_t mask);
         void     clearFaultStatus();
-        PowerStarProfile    getProfileStatus();
+        // afterStatus: getStatus() just ran, its motor/LED read is reused
+        PowerStarProfile    getProfileStatus(bool afterStatus = false);
 
-        bool     setDew(uint8_t channel, uint8_t percent);
+        // keep: the setting belongs in nvm, AutoDew's passing ones don't
+        bool     setDew(uint8_t channel, uint8_t percent, bool keep = true);
         bool     setPWM(uint16_t pwmamt);
         bool     setPowerState(const string &device, const string &action);
         bool     setAutoBoot(const string &device, const string &action);
@@ -192,6 +202,22 @@ class PSCTL
         bool    setMaxPosition(uint32_t ticks);
         bool    getMaxPosition(uint32_t *ticks);
         
+        /**
+         * @brief sampleADC Read one voltage/current channel back to back over a single
+         *        HID session. The device is held per sample, other commands go in
+         *        between (and show as gaps in usec).
+         * @param ch PS_CHANNEL, must be one of the ADC volts/amps channels
+         * @param durationMs how long to sample
+         * @param usec receives the time of each sample from the start
+         * @param raw receives the ADC counts of each sample
+         * @param maxSamples size of usec and raw
+         * @return number of samples read
+         */
+        uint32_t sampleADC(uint8_t ch, uint32_t durationMs, uint32_t *usec, uint16_t *raw, uint32_t maxSamples);
+        
+        // PS_VOLTS/PS_CURRENT command and argument for a channel, false if not an ADC channel
+        static bool adcCommand(uint8_t ch, PS_COMMANDS *cmd, uint8_t *arg);
+        
     private:
         
         /**
@@ -210,18 +236,55 @@ class PSCTL
          */
         bool getPosition(uint32_t *ticks, uint8_t cmdCode);
         
+        void setChannel(uint8_t ch, uint16_t raw);
+        
         int32_t simPosition { 0 };
         uint32_t targetPosition { 0 };
+        
+        // position high nibble (abs, max), re-read only when it may have changed
+        uint8_t  posHigh[2] {};
+        bool     posHighKnown[2] {};
+        uint16_t lastPosLow { 0 };
+        uint8_t  lastMotion { 0 };      // getFocusStatus()
+        bool     posMayCross { false }; // driver move to another block under way
+        void     forgetPosHigh(int which) { posHighKnown[which] = false; }
+        
+        // the hub's profile as last read or written, setProfileStatus
+        // only writes the fields that differ from it
+        PowerStarProfile applied {};
+        bool     appliedKnown { false };
+        bool     brakingKnown { false };    // not readable, known once written
+        bool     nvmDirty { false };        // dew/pwm/mp/led/limits changed since the last nvm commit
+        // dew channel settings as last written and as the nvm commit
+        // saved them, -1 unknown
+        int16_t  dewWritten[3] { -1, -1, -1 };
+        int16_t  dewCommitted[3] { -1, -1, -1 };
+        bool     profileFailed();
         uint8_t* response = {0};
         
         bool isConnected;
         
         uint8_t* hidCMD(PS_COMMANDS hcmd, uint8_t hidArg1, uint8_t hidArg2, int numCmd);
         
-        hid_device *handle { nullptr };
+        // the hub, or the emulator when PS_EMULATE is set
+        unique_ptr<PSTransport> transport;
+        
+        // hidCMD may be called from the driver thread while a burst is sampling
+        std::mutex hidMutex;
 
         // Driver Timeout in ms
         static const uint16_t PS_TIMEOUT { 1000 };       
+        
+        // extra attempts to open the device before a command fails
+        static const int PS_OPEN_RETRIES { 2 };
+        static const int PS_OPEN_RETRY_US { 5000 };
+        
+        // getFocusStatus() while moving
+        static const uint8_t PS_MTR_IN { 1 };
+        static const uint8_t PS_MTR_OUT { 2 };
+        
+        // steps from a 65536 boundary at which a moving focuser's high bits are re-read
+        static const uint16_t PS_POS_EDGE { 0x1000 };
 
 };
 
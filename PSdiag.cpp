@@ -0,0 +1,209 @@
+/***************************************************************
+*  Program:      PSdiag.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star per command latency statistics
+****************************************************************/
+
+#include "PSdiag.h"
+#include "PScontrol.h"
+#include <string.h>
+
+using namespace std;
+
+const uint8_t psDiagShown[PS_DIAG_SHOWN] = {
+    PSCTL::PS_GET_STATUS, PSCTL::PS_PORT_STATUS, PSCTL::PS_DEW_STATUS, PSCTL::PS_VOLTS,
+    PSCTL::PS_CURRENT, PSCTL::PS_GET_WEATHER, PSCTL::PS_FAULT1, PSCTL::PS_FAULT2,
+    PSCTL::PS_GET_POS, PSCTL::PS_GET_HBITS, PSCTL::PS_MTR_CMD, PSCTL::PS_PORT_CTL,
+    PSCTL::PS_DEW_CTL, PSCTL::PS_GET_VAR, PSCTL::PS_SET_VAR, PSCTL::PS_GET_PWM,
+    PSCTL::PS_SET_PWM, PSCTL::PS_GET_AUTO, PSCTL::PS_SET_AUTO, PSCTL::PS_GET_ULIMIT,
+    PSCTL::PS_SET_ULIMIT, PSCTL::PS_SET_POS, PSCTL::PS_SET_HBITS, PSCTL::PS_GET_SPERIOD,
+    PSCTL::PS_SET_SPERIOD, PSCTL::PS_GET_BACKLASH, PSCTL::PS_SET_BACKLASH, PSCTL::PS_GET_HYS,
+    PSCTL::PS_SET_HYS, PSCTL::PS_GET_TMPCOEF, PSCTL::PS_SET_TMPCOEF, PSCTL::PS_GET_TCOMP,
+    PSCTL::PS_SET_TCOMP, PSCTL::PS_GET_MTRCUR, PSCTL::PS_SET_MTRCUR, PSCTL::PS_GET_MTRPOL,
+    PSCTL::PS_SET_MTRPOL, PSCTL::PS_SET_MTRLCK, PSCTL::PS_GET_MTR_LED, PSCTL::PS_SET_MTR_LED,
+    PSCTL::PS_VERSION, PSCTL::PS_RESET
+};
+
+//******************************************************************
+PSDiag &psDiag()
+{
+    static PSDiag diag;
+    return diag;
+}
+
+//******************************************************************
+uint32_t PSDiag::bucket(uint32_t usec)
+{
+    if (usec < PS_DIAG_SUB)
+        return usec;
+    if (usec > PS_DIAG_MAX_US)
+        usec = PS_DIAG_MAX_US;
+
+    uint32_t msb = 31 - __builtin_clz(usec);
+    return (msb - 2) * PS_DIAG_SUB + ((usec >> (msb - 3)) & (PS_DIAG_SUB - 1));
+}
+
+//******************************************************************
+uint32_t PSDiag::bucketTop(uint32_t b)
+{
+    if (b < PS_DIAG_SUB)
+        return b;
+
+    uint32_t msb = b / PS_DIAG_SUB + 2;
+    uint32_t sub = b % PS_DIAG_SUB;
+    return ((PS_DIAG_SUB + sub + 1) << (msb - 3)) - 1;
+}
+
+//******************************************************************
+void PSDiag::summarize(const uint64_t *hist, psDiagSummary *s) const
+{
+    const double pct[3] = { 0.50, 0.95, 0.99 };
+    uint32_t *out[3] = { &s->p50, &s->p95, &s->p99 };
+    uint64_t n = 0;
+
+    for (uint32_t b = 0; b < PS_DIAG_BUCKETS; b++)
+        n += hist[b];
+
+    s->p50 = s->p95 = s->p99 = 0;
+    if (n == 0)
+        return;
+
+    for (int p = 0; p < 3; p++)
+    {
+        uint64_t rank = uint64_t(pct[p] * n + 0.5);
+        uint64_t seen = 0;
+        if (rank < 1)
+            rank = 1;
+        for (uint32_t b = 0; b < PS_DIAG_BUCKETS; b++)
+        {
+            seen += hist[b];
+            if (seen >= rank)
+            {
+                *out[p] = bucketTop(b);
+                break;
+            }
+        }
+        // the bucket top can overstate the slowest call seen
+        if (s->max > 0 && *out[p] > s->max)
+            *out[p] = s->max;
+    }
+}
+
+//******************************************************************
+psDiagSummary PSDiag::summary(uint8_t op) const
+{
+    const psDiagOp &o = ops[op];
+    uint64_t hist[PS_DIAG_BUCKETS];
+    psDiagSummary s;
+
+    s.calls = o.calls.load(memory_order_relaxed);
+    s.timeouts = o.timeouts.load(memory_order_relaxed);
+    s.retries = o.retries.load(memory_order_relaxed);
+    s.errors = o.errors.load(memory_order_relaxed);
+    s.sumUs = o.sumUs.load(memory_order_relaxed);
+    s.max = o.max.load(memory_order_relaxed);
+    for (uint32_t b = 0; b < PS_DIAG_BUCKETS; b++)
+        hist[b] = o.hist[b].load(memory_order_relaxed);
+
+    summarize(hist, &s);
+    return s;
+}
+
+//******************************************************************
+psDiagSummary PSDiag::total() const
+{
+    uint64_t hist[PS_DIAG_BUCKETS] = {0};
+    psDiagSummary s;
+    memset(&s, 0, sizeof(s));
+
+    for (const psDiagOp &o : ops)
+    {
+        s.calls += o.calls.load(memory_order_relaxed);
+        s.timeouts += o.timeouts.load(memory_order_relaxed);
+        s.retries += o.retries.load(memory_order_relaxed);
+        s.errors += o.errors.load(memory_order_relaxed);
+        s.sumUs += o.sumUs.load(memory_order_relaxed);
+        uint32_t m = o.max.load(memory_order_relaxed);
+        if (m > s.max)
+            s.max = m;
+        for (uint32_t b = 0; b < PS_DIAG_BUCKETS; b++)
+            hist[b] += o.hist[b].load(memory_order_relaxed);
+    }
+
+    summarize(hist, &s);
+    return s;
+}
+
+//******************************************************************
+void PSDiag::reset()
+{
+    for (psDiagOp &o : ops)
+    {
+        o.calls.store(0, memory_order_relaxed);
+        o.timeouts.store(0, memory_order_relaxed);
+        o.retries.store(0, memory_order_relaxed);
+        o.errors.store(0, memory_order_relaxed);
+        o.sumUs.store(0, memory_order_relaxed);
+        o.max.store(0, memory_order_relaxed);
+        for (atomic<uint32_t> &h : o.hist)
+            h.store(0, memory_order_relaxed);
+    }
+}
+
+//******************************************************************
+const char *psOpcodeName(uint8_t op)
+{
+    switch (op)
+    {
+        case PSCTL::PS_NOOP:         return "NOOP";
+        case PSCTL::PS_MTR_CMD:      return "MTR_CMD";
+        case PSCTL::PS_GET_STATUS:   return "GET_STATUS";
+        case PSCTL::PS_FAST_OUT:     return "FAST_OUT";
+        case PSCTL::PS_SET_POS:      return "SET_POS";
+        case PSCTL::PS_GET_POS:      return "GET_POS";
+        case PSCTL::PS_SET_MAX:      return "SET_MAX";
+        case PSCTL::PS_GET_MAX:      return "GET_MAX";
+        case PSCTL::PS_SET_HBITS:    return "SET_HBITS";
+        case PSCTL::PS_GET_HBITS:    return "GET_HBITS";
+        case PSCTL::PS_SET_SPERIOD:  return "SET_SPERIOD";
+        case PSCTL::PS_GET_SPERIOD:  return "GET_SPERIOD";
+        case PSCTL::PS_SET_BACKLASH: return "SET_BACKLASH";
+        case PSCTL::PS_GET_BACKLASH: return "GET_BACKLASH";
+        case PSCTL::PS_SET_HYS:      return "SET_HYS";
+        case PSCTL::PS_GET_HYS:      return "GET_HYS";
+        case PSCTL::PS_SET_TMPCOEF:  return "SET_TMPCOEF";
+        case PSCTL::PS_GET_TMPCOEF:  return "GET_TMPCOEF";
+        case PSCTL::PS_SET_TCOMP:    return "SET_TCOMP";
+        case PSCTL::PS_GET_TCOMP:    return "GET_TCOMP";
+        case PSCTL::PS_SET_MTRCUR:   return "SET_MTRCUR";
+        case PSCTL::PS_GET_MTRCUR:   return "GET_MTRCUR";
+        case PSCTL::PS_GET_WEATHER:  return "GET_WEATHER";
+        case PSCTL::PS_VERSION:      return "VERSION";
+        case PSCTL::PS_SET_MTRPOL:   return "SET_MTRPOL";
+        case PSCTL::PS_GET_MTRPOL:   return "GET_MTRPOL";
+        case PSCTL::PS_SET_MTRLCK:   return "SET_MTRLCK";
+        case PSCTL::PS_GET_MTRLCK:   return "GET_MTRLCK";
+        case PSCTL::PS_PORT_CTL:     return "PORT_CTL";
+        case PSCTL::PS_PORT_STATUS:  return "PORT_STATUS";
+        case PSCTL::PS_SET_VAR:      return "SET_VAR";
+        case PSCTL::PS_GET_VAR:      return "GET_VAR";
+        case PSCTL::PS_SET_PWM:      return "SET_PWM";
+        case PSCTL::PS_GET_PWM:      return "GET_PWM";
+        case PSCTL::PS_DEW_CTL:      return "DEW_CTL";
+        case PSCTL::PS_DEW_STATUS:   return "DEW_STATUS";
+        case PSCTL::PS_VOLTS:        return "VOLTS";
+        case PSCTL::PS_CURRENT:      return "CURRENT";
+        case PSCTL::PS_SET_AUTO:     return "SET_AUTO";
+        case PSCTL::PS_GET_AUTO:     return "GET_AUTO";
+        case PSCTL::PS_SET_MTR_LED:  return "SET_MTR_LED";
+        case PSCTL::PS_GET_MTR_LED:  return "GET_MTR_LED";
+        case PSCTL::PS_FAULT1:       return "FAULT1";
+        case PSCTL::PS_FAULT2:       return "FAULT2";
+        case PSCTL::PS_SET_ULIMIT:   return "SET_ULIMIT";
+        case PSCTL::PS_GET_ULIMIT:   return "GET_ULIMIT";
+        case PSCTL::PS_RESET:        return "RESET";
+        case PSCTL::PS_HALT:         return "HALT";
+        default:                     return "UNKNOWN";
+    }
+}
@@ -0,0 +1,90 @@
+/********************************************************
+*  Program:      PSdiag.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star per command latency statistics
+*********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+using namespace std;
+
+// Log-linear latency histogram in microseconds: 8 buckets per power of
+// two (12.5% resolution) from 8 us up to 2^25 us (~33 s), exact below 8 us.
+#define PS_DIAG_SUB         8
+#define PS_DIAG_BUCKETS     184
+#define PS_DIAG_MAX_US      ((1u << 25) - 1)
+
+// commands shown on the Diagnostics tab, the ones the driver sends
+#define PS_DIAG_SHOWN       42
+extern const uint8_t psDiagShown[PS_DIAG_SHOWN];
+
+typedef struct {
+            uint64_t calls;
+            uint64_t timeouts;     // no reply within the driver timeout
+            uint64_t retries;      // device open attempts repeated
+            uint64_t errors;       // commands that returned 0xff to the caller
+            uint64_t sumUs;        // all round trips added up
+            uint32_t p50, p95, p99, max;   // us
+} psDiagSummary;
+
+// Every PSCTL shares one set of counters (one hub per process).  Recording
+// is relaxed atomic adds into fixed arrays: no locks, no allocation.
+class PSDiag
+{
+    public:
+        /**
+         * @brief record One command round trip
+         * @param op PS_COMMANDS opcode
+         * @param usec open .. close time of the command
+         */
+        void    record(uint8_t op, uint32_t usec)
+        {
+            psDiagOp &o = ops[op];
+            o.calls.fetch_add(1, memory_order_relaxed);
+            o.sumUs.fetch_add(usec, memory_order_relaxed);
+            o.hist[bucket(usec)].fetch_add(1, memory_order_relaxed);
+            uint32_t m = o.max.load(memory_order_relaxed);
+            while (usec > m && !o.max.compare_exchange_weak(m, usec, memory_order_relaxed))
+                ;
+        }
+
+        void    timeout(uint8_t op) { ops[op].timeouts.fetch_add(1, memory_order_relaxed); }
+        void    retry(uint8_t op)   { ops[op].retries.fetch_add(1, memory_order_relaxed); }
+        void    error(uint8_t op)   { ops[op].errors.fetch_add(1, memory_order_relaxed); }
+
+        // percentiles and counts of one opcode, or of every command
+        psDiagSummary summary(uint8_t op) const;
+        psDiagSummary total() const;
+
+        // zero everything, commands in flight may land either side of the reset
+        void    reset();
+
+        static uint32_t bucket(uint32_t usec);
+        // largest latency that falls in bucket b
+        static uint32_t bucketTop(uint32_t b);
+
+    private:
+        typedef struct {
+            atomic<uint64_t> calls;
+            atomic<uint64_t> timeouts;
+            atomic<uint64_t> retries;
+            atomic<uint64_t> errors;
+            atomic<uint64_t> sumUs;
+            atomic<uint32_t> max;
+            atomic<uint32_t> hist[PS_DIAG_BUCKETS];
+        } psDiagOp;
+
+        void    summarize(const uint64_t *hist, psDiagSummary *s) const;
+
+        psDiagOp ops[256] {};
+};
+
+// process wide statistics
+PSDiag &psDiag();
+
+// PS_COMMANDS name of an opcode, "UNKNOWN" for ones the hub does not have
+const char *psOpcodeName(uint8_t op);
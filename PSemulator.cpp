@@ -0,0 +1,558 @@
+/***************************************************************
+*  Program:      PSemulator.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star device emulator
+*
+*  Reply formats follow what PScontrol.cpp decodes: byte 0 echoes
+*  the opcode, bytes 1/2 are the low/high data bytes and 0xff
+*  flags an error.
+****************************************************************/
+
+#include "PSemulator.h"
+#include "PScontrol.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+// default USB timing, one interrupt transfer each way
+static const uint32_t DEF_LATENCY = 2000;
+static const uint32_t DEF_JITTER = 500;
+static const uint32_t DEF_OPEN = 15000;
+
+PSEmulator::PSEmulator()
+{
+    setLatency(DEF_LATENCY, DEF_JITTER);
+    openUs = DEF_OPEN;
+
+    for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+        fullAmps[ch] = 0;
+    fullAmps[PS_CH_OUT1_AMPS] = 0.8;
+    fullAmps[PS_CH_OUT2_AMPS] = 1.2;
+    fullAmps[PS_CH_OUT3_AMPS] = 0.4;
+    fullAmps[PS_CH_OUT4_AMPS] = 0.3;
+    fullAmps[PS_CH_VAR_AMPS] = 0.5;
+    fullAmps[PS_CH_MP_AMPS] = 0.6;
+    fullAmps[PS_CH_DEW1_AMPS] = 1.5;
+    fullAmps[PS_CH_DEW2_AMPS] = 1.5;
+
+    // factory NVM
+    memset(&nvm, 0, sizeof(nvm));
+    nvm.var = 50;
+    nvm.mtrLed[0] = 0x30;
+    nvm.backlash = 20;
+    nvm.idleCur = 1;
+    nvm.driveCur = 5;
+    nvm.speriod = 10;
+    nvm.maxPos = 100000;
+
+    powerOn();
+}
+
+//******************************************************************
+void PSEmulator::powerOn()
+{
+    lock_guard<mutex> l(lock);
+
+    live = nvm;
+    portMask = nvm.autoMask;
+    fault1 = fault2 = 0;
+    mtrLocked = true;
+    moving = false;
+    moveStart = chrono::steady_clock::now();
+}
+
+//******************************************************************
+void PSEmulator::configure(const char *spec)
+{
+    char buf[256];
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *save = nullptr;
+    for (char *tok = strtok_r(buf, ",", &save); tok != nullptr; tok = strtok_r(nullptr, ",", &save))
+    {
+        char *eq = strchr(tok, '=');
+        if (eq == nullptr)
+            continue;
+        *eq = '\0';
+        const char *val = eq + 1;
+
+        if (strcmp(tok, "latency") == 0)
+            setLatency(strtoul(val, nullptr, 0), jitterUs[0]);
+        else if (strcmp(tok, "jitter") == 0)
+            setLatency(latencyUs[0], strtoul(val, nullptr, 0));
+        else if (strcmp(tok, "open") == 0)
+            openUs = strtoul(val, nullptr, 0);
+        else if (strcmp(tok, "seed") == 0)
+            rng = strtoul(val, nullptr, 0) | 1;
+        else if (strncmp(tok, "0x", 2) == 0)
+        {
+            char *slash;
+            uint32_t lat = strtoul(val, &slash, 0);
+            uint32_t jit = *slash == '/' ? strtoul(slash + 1, nullptr, 0) : 0;
+            setLatency(uint8_t(strtoul(tok, nullptr, 16)), lat, jit);
+        }
+    }
+}
+
+//******************************************************************
+void PSEmulator::setLatency(uint32_t lat, uint32_t jit)
+{
+    lock_guard<mutex> l(lock);
+    for (int op = 0; op < 256; op++)
+    {
+        latencyUs[op] = lat;
+        jitterUs[op] = jit;
+    }
+}
+
+//******************************************************************
+void PSEmulator::setLatency(uint8_t opcode, uint32_t lat, uint32_t jit)
+{
+    lock_guard<mutex> l(lock);
+    latencyUs[opcode] = lat;
+    jitterUs[opcode] = jit;
+}
+
+//******************************************************************
+void PSEmulator::setLoad(uint8_t ch, float amps)
+{
+    lock_guard<mutex> l(lock);
+    if (ch < PS_CH_N)
+        fullAmps[ch] = amps;
+}
+
+//******************************************************************
+void PSEmulator::injectFault(uint16_t f1, uint16_t f2)
+{
+    lock_guard<mutex> l(lock);
+    fault1 |= f1;
+    fault2 |= f2;
+}
+
+//******************************************************************
+bool PSEmulator::takeDrop()
+{
+    lock_guard<mutex> l(lock);
+    if (drops == 0)
+        return false;
+    drops--;
+    return true;
+}
+
+//******************************************************************
+uint32_t PSEmulator::position()
+{
+    lock_guard<mutex> l(lock);
+    psEmuTime now = chrono::steady_clock::now();
+    updateMotion(now);
+    updateWeather(now);
+    return uint32_t(pos);
+}
+
+//******************************************************************
+// latency +/- jitter, xorshift so runs are repeatable for a seed
+uint32_t PSEmulator::delay(uint8_t opcode)
+{
+    uint32_t jit = jitterUs[opcode];
+    if (jit == 0)
+        return latencyUs[opcode];
+
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    int32_t d = int32_t(latencyUs[opcode]) + int32_t(rng % (2 * jit + 1)) - int32_t(jit);
+    return d > 0 ? d : 0;
+}
+
+//******************************************************************
+void PSEmulator::startMove(uint32_t target, psEmuTime now)
+{
+    updateMotion(now);
+    if (target > live.maxPos)
+        target = live.maxPos;
+
+    moveFrom = pos;
+    moveTo = target;
+    moveStart = now;
+    moving = uint32_t(pos) != target;
+
+    // ending against the preferred direction, go past by the backlash and come back
+    bool out = target > pos;
+    moveVia = target;
+    if (moving && live.backlash != 0 && out != (live.prefDir == 1))
+        moveVia = out ? min(target + live.backlash, live.maxPos) : (target > live.backlash ? target - live.backlash : 0);
+    legTo = moveVia;
+}
+
+//******************************************************************
+void PSEmulator::updateMotion(psEmuTime now)
+{
+    if (!moving)
+        return;
+
+    double secs = chrono::duration<double>(now - moveStart).count();
+    double stepsPerSec = 10000.0 / (live.speriod ? live.speriod : 1);
+    double travelled = secs * stepsPerSec;
+    double leg1 = fabs(moveVia - moveFrom);
+    double leg2 = fabs(double(moveTo) - moveVia);
+
+    if (travelled >= leg1 + leg2)
+    {
+        pos = moveTo;
+        moving = false;
+    }
+    else if (travelled < leg1)
+        pos = moveVia > moveFrom ? moveFrom + travelled : moveFrom - travelled;
+    else
+    {
+        legTo = moveTo;
+        pos = moveTo > moveVia ? moveVia + (travelled - leg1) : moveVia - (travelled - leg1);
+    }
+}
+
+//******************************************************************
+void PSEmulator::setWeather(float tempC, float hum)
+{
+    lock_guard<mutex> l(lock);
+    tempC_ = driftBase = tempC;
+    hum_ = hum;
+    driftFrom = chrono::steady_clock::now();
+}
+
+//******************************************************************
+void PSEmulator::setDrift(double cPerSec)
+{
+    lock_guard<mutex> l(lock);
+    driftBase = tempC_;
+    driftFrom = chrono::steady_clock::now();
+    driftCPerSec = cPerSec;
+}
+
+//******************************************************************
+// Drift the temperature.  When the hub compensates for it, once a
+// second while the focuser is at rest it moves the focuser by the
+// coefficient (steps/C, 8.8) if the change reached the hysteresis
+// (C * 10).  Cooling moves out.
+void PSEmulator::updateWeather(psEmuTime now)
+{
+    if (driftCPerSec != 0)
+        tempC_ = driftBase + driftCPerSec * chrono::duration<double>(now - driftFrom).count();
+
+    double coef = live.tmpCoef[1] + live.tmpCoef[0] / 256.0;
+    if (live.tcomp == 0 || coef == 0)
+    {
+        tcRefSet = false;
+        return;
+    }
+    if (!tcRefSet)
+    {
+        tcRefC = tempC_;
+        tcRefSet = true;
+        tcNext = now + chrono::seconds(1);
+        return;
+    }
+    if (now < tcNext)
+        return;
+
+    // the check happened at tcNext, not when somebody asked
+    psEmuTime at = tcNext;
+    tcNext += chrono::seconds(1);
+    if (tcNext < now)
+        tcNext = now + chrono::seconds(1);
+
+    updateMotion(at);
+    if (moving)
+        return;
+
+    float t = driftCPerSec != 0 ? driftBase + driftCPerSec * chrono::duration<double>(at - driftFrom).count() : tempC_;
+    if (fabs(t - tcRefC) < max(live.hys / 10.0, 0.1))
+        return;
+
+    long steps = lround(coef * (tcRefC - t));
+    double to = min(max(pos + steps, 0.0), double(live.maxPos));
+    tcRefC = t;
+    startMove(uint32_t(to), at);
+    updateMotion(now);
+}
+
+//******************************************************************
+uint16_t PSEmulator::adcVolts(uint8_t idx)
+{
+    switch (idx)
+    {
+        case 0: return uint16_t(inVolts / psChannels[PS_CH_IN_VOLTS].scale);
+        case 1: return (portMask & 0x40) ? uint16_t(live.var / 10.0 / psChannels[PS_CH_VAR_VOLTS].scale) : 0;
+        case 2: return uint16_t(5.0 / psChannels[PS_CH_INT_VOLTS].scale);
+        default: return 0;
+    }
+}
+
+//******************************************************************
+uint16_t PSEmulator::adcCurrent(uint8_t idx)
+{
+    // PS_CURRENT argument order, port mask bit of each
+    static const uint8_t chan[8] = { PS_CH_OUT1_AMPS, PS_CH_OUT2_AMPS, PS_CH_OUT3_AMPS, PS_CH_OUT4_AMPS,
+                                     PS_CH_DEW1_AMPS, PS_CH_DEW2_AMPS, PS_CH_VAR_AMPS, PS_CH_MP_AMPS };
+    static const uint16_t bit[8] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+
+    // a count of noise like the real ADC
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    int noise = int(rng % 3) - 1;
+
+    if (idx < 8)
+    {
+        // dew reads full scale, the driver weights it by the duty cycle
+        bool on = idx == 4 || idx == 5 ? live.dew[idx - 4] > 0 : (portMask & bit[idx]) != 0;
+        if (!on)
+            return 0;
+        int raw = int(fullAmps[chan[idx]] / psChannels[chan[idx]].scale) + noise;
+        return raw > 0 ? raw : 0;
+    }
+
+    if (idx == 8)
+    {
+        float total = 0.05;      // the hub itself
+        for (int i = 0; i < 8; i++)
+        {
+            if (i == 4 || i == 5)
+                total += fullAmps[chan[i]] * live.dew[i - 4] / 100.0;
+            else if (portMask & bit[i])
+                total += fullAmps[chan[i]];
+        }
+        int raw = int(total / psChannels[PS_CH_IN_AMPS].scale) + noise;
+        return raw > 0 ? raw : 0;
+    }
+
+    return 0;
+}
+
+//******************************************************************
+uint32_t PSEmulator::command(const uint8_t *cmd, int len, uint8_t res[3])
+{
+    lock_guard<mutex> l(lock);
+
+    psEmuTime now = chrono::steady_clock::now();
+    uint8_t op = cmd[0];
+    uint8_t a1 = len > 1 ? cmd[1] : 0;
+    uint8_t a2 = len > 2 ? cmd[2] : 0;
+    uint16_t v = 0;
+
+    commands++;
+    updateMotion(now);
+    updateWeather(now);
+
+    res[0] = op;
+    res[1] = res[2] = 0;
+
+    switch (op)
+    {
+        // Focuser
+        case PSCTL::PS_MTR_CMD:
+            switch (a1)
+            {
+                case PSCTL::PS_IN:      startMove(0, now); break;
+                case PSCTL::PS_OUT:     startMove(live.maxPos, now); break;
+                case PSCTL::PS_GOTO:    startMove(staged, now); break;
+                case PSCTL::PS_CMD_POS: moving = false; pos = staged; break;
+                case PSCTL::PS_CMD_MAX: live.maxPos = staged; break;
+                case PSCTL::PS_HALT:    moving = false; pos = floor(pos); break;
+                default:                res[1] = 0xff; break;
+            }
+            break;
+        case PSCTL::PS_GET_STATUS:
+            if (moving)
+                res[1] = legTo > pos ? 2 : 1;           // out : in
+            else
+                res[1] = mtrLocked ? 5 : 0;
+            break;
+        case PSCTL::PS_FAST_OUT:
+            startMove(live.maxPos, now);
+            break;
+        case PSCTL::PS_SET_HBITS:
+            stagedHigh = a1 & 0x0f;
+            break;
+        case PSCTL::PS_GET_HBITS:
+            res[1] = ((a1 == PSCTL::PS_MAX ? live.maxPos : uint32_t(pos)) >> 16) & 0x0f;
+            break;
+        case PSCTL::PS_SET_POS:
+        case PSCTL::PS_SET_MAX:
+            staged = (uint32_t(stagedHigh) << 16) | (a2 << 8) | a1;
+            break;
+        case PSCTL::PS_GET_POS:
+        case PSCTL::PS_GET_MAX:
+            v = (a1 == PSCTL::PS_MAX || op == PSCTL::PS_GET_MAX ? live.maxPos : uint32_t(pos)) & 0xffff;
+            break;
+        case PSCTL::PS_SET_SPERIOD:  live.speriod = a1 ? a1 : 1; res[1] = a1; break;
+        case PSCTL::PS_GET_SPERIOD:  res[1] = live.speriod; break;
+        case PSCTL::PS_SET_BACKLASH: live.backlash = a1; live.prefDir = a2; break;
+        case PSCTL::PS_GET_BACKLASH: res[1] = live.backlash; res[2] = live.prefDir; break;
+        case PSCTL::PS_SET_HYS:      live.hys = a1; res[1] = a1; break;
+        case PSCTL::PS_GET_HYS:      res[1] = live.hys; break;
+        case PSCTL::PS_SET_TMPCOEF:  live.tmpCoef[0] = a1; live.tmpCoef[1] = a2; break;
+        case PSCTL::PS_GET_TMPCOEF:  res[1] = live.tmpCoef[0]; res[2] = live.tmpCoef[1]; break;
+        case PSCTL::PS_SET_TCOMP:    live.tcomp = a1; res[1] = a1; break;
+        case PSCTL::PS_GET_TCOMP:    res[1] = live.tcomp; break;
+        case PSCTL::PS_SET_MTRCUR:   live.idleCur = a1; live.driveCur = a2; res[1] = a1; res[2] = a2; break;
+        case PSCTL::PS_GET_MTRCUR:   res[1] = live.idleCur; res[2] = live.driveCur; break;
+        case PSCTL::PS_SET_MTRPOL:   live.mtrPol = a1; res[1] = a1; break;
+        case PSCTL::PS_GET_MTRPOL:   res[1] = live.mtrPol; break;
+        case PSCTL::PS_SET_MTRLCK:
+            if (a1 == 0xa5)
+                mtrLocked = true;
+            else if (a1 == 0x5a)
+                mtrLocked = false;
+            else if (a1 == 0xaa)
+            {
+                // commit to NVM
+                live.braking = a2;
+                nvm = live;
+                nvmWrites++;
+            }
+            else
+                res[1] = 0xff;
+            break;
+        case PSCTL::PS_GET_MTRLCK:   res[1] = mtrLocked; res[2] = live.braking; break;
+
+        // Environment and version
+        case PSCTL::PS_GET_WEATHER:
+            if (a1 == PSCTL::PS_TEMP)
+                v = uint16_t(int16_t(lround(tempC_ * 256)));
+            else
+                v = uint16_t(lround(hum_));
+            break;
+        case PSCTL::PS_VERSION:      v = 0x0203; break;
+
+        // Power
+        case PSCTL::PS_PORT_CTL:     portMask = (a2 << 8) | a1; res[1] = a1; res[2] = a2; break;
+        case PSCTL::PS_PORT_STATUS:  v = portMask | (live.dew[0] ? 0x10 : 0) | (live.dew[1] ? 0x20 : 0); break;
+        case PSCTL::PS_SET_AUTO:     live.autoMask = (a2 << 8) | a1; res[1] = a1; res[2] = a2; break;
+        case PSCTL::PS_GET_AUTO:     v = live.autoMask; break;
+        case PSCTL::PS_SET_VAR:      live.var = a1; res[1] = a1; break;
+        case PSCTL::PS_GET_VAR:      res[1] = live.var; break;
+        case PSCTL::PS_SET_PWM:      live.pwm = (a2 << 8) | a1; v = live.pwm; break;
+        case PSCTL::PS_GET_PWM:      v = live.pwm; break;
+        case PSCTL::PS_DEW_CTL:
+            if (a1 > 2 || a2 > 100)
+                res[2] = 0xff;
+            else
+                live.dew[a1] = a2;
+            break;
+        case PSCTL::PS_DEW_STATUS:   res[1] = a1; res[2] = a1 <= 2 ? live.dew[a1] : 0xff; break;
+        case PSCTL::PS_VOLTS:        v = adcVolts(a1); break;
+        case PSCTL::PS_CURRENT:      v = adcCurrent(a1); break;
+        case PSCTL::PS_SET_MTR_LED:  live.mtrLed[0] = a1; live.mtrLed[1] = a2; res[1] = a1; res[2] = a2; break;
+        case PSCTL::PS_GET_MTR_LED:  res[1] = live.mtrLed[0]; res[2] = live.mtrLed[1]; break;
+        case PSCTL::PS_SET_ULIMIT:
+            if (a1 < 12)
+                live.ulimit[a1] = a2;
+            break;
+        case PSCTL::PS_GET_ULIMIT:
+            // the limits for the 12V inputs and most outputs are kept in 4 count steps
+            if (a1 < 12)
+                v = (a1 >= 4 && a1 <= 6) ? live.ulimit[a1] : live.ulimit[a1] * 4;
+            break;
+
+        // Faults and maintenance
+        case PSCTL::PS_FAULT1:       v = fault1 & ~((a2 << 8) | a1); break;
+        case PSCTL::PS_FAULT2:
+            if (a1 == 0x01)
+                fault1 = fault2 = 0;
+            else
+                v = fault2;
+            break;
+        case PSCTL::PS_RESET:
+            if (a1 == 0xa5 && a2 == 0x5a)
+            {
+                live = nvm;
+                portMask = nvm.autoMask;
+                fault1 = fault2 = 0;
+                moving = false;
+                mtrLocked = true;
+            }
+            else
+                res[1] = 0xff;
+            break;
+
+        default:
+            res[1] = res[2] = 0xff;
+            break;
+    }
+
+    if (v != 0)
+    {
+        res[1] = v & 0xff;
+        res[2] = v >> 8;
+    }
+
+    return delay(op);
+}
+
+//******************************************************************
+PSEmulator &psEmulator()
+{
+    static PSEmulator hub;
+    return hub;
+}
+
+/***************************************************************/
+/* Transport                                                   */
+/***************************************************************/
+bool PSEmuTransport::open()
+{
+    if (!emu.isPresent())
+        return false;
+
+    this_thread::sleep_for(chrono::microseconds(emu.openSession()));
+    opened = true;
+    pending = false;
+    return true;
+}
+
+//******************************************************************
+int PSEmuTransport::write(const uint8_t *cmd, int len)
+{
+    // unplugged under an open session
+    if (!opened || len < 1 || !emu.isPresent())
+        return -1;
+
+    // lost on the way, read() times out
+    if (emu.takeDrop())
+    {
+        pending = false;
+        return len;
+    }
+
+    uint32_t us = emu.command(cmd, len, reply);
+    ready = chrono::steady_clock::now() + chrono::microseconds(us);
+    pending = true;
+    return len;
+}
+
+//******************************************************************
+int PSEmuTransport::read(uint8_t *res, int len, int timeoutMs)
+{
+    if (!opened)
+        return -1;
+
+    psEmuTime deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    if (!pending || ready > deadline)
+    {
+        this_thread::sleep_until(deadline);
+        return 0;
+    }
+
+    this_thread::sleep_until(ready);
+    pending = false;
+
+    int n = len < 3 ? len : 3;
+    memcpy(res, reply, n);
+    return n;
+}
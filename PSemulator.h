@@ -0,0 +1,176 @@
+/********************************************************
+*  Program:      PSemulator.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star device emulator
+*********************************************************/
+
+#pragma once
+
+#include "PSchannels.h"
+#include "PStransport.h"
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+
+using namespace std;
+
+typedef chrono::steady_clock::time_point psEmuTime;
+
+// everything PS_SET_MTRLCK 0xaa commits and PS_RESET restores
+typedef struct {
+            uint16_t autoMask;
+            uint8_t  dew[3];
+            uint16_t pwm;
+            uint8_t  var;              // volts * 10
+            uint8_t  mtrLed[2];        // MP type | LED << 4, motor type
+            uint8_t  backlash;
+            uint8_t  prefDir;
+            uint8_t  idleCur;
+            uint8_t  driveCur;
+            uint8_t  speriod;          // ms per step * 10
+            uint8_t  tmpCoef[2];       // 8.8, low byte first
+            uint8_t  hys;
+            uint8_t  tcomp;
+            uint8_t  mtrPol;
+            uint8_t  braking;
+            uint8_t  ulimit[12];
+            uint32_t maxPos;
+} psEmuNVM;
+
+/**
+ * Software Power*Star.  Implements every PSCTL::PS_COMMANDS opcode
+ * against a simulated hub: port/USB/autoboot masks, dew, PWM, variable
+ * output, ADC volts and currents that follow the switched loads,
+ * weather (optionally drifting), a 20 bit focuser that moves in real time at the step
+ * period with the firmware's temperature compensation, fault
+ * registers and NVM.  Moves against the preferred direction go past
+ * by the backlash and come back, which is PSMotion's assumption, not
+ * documented firmware behaviour, so the emulator can't tell whether
+ * move predictions hold on a real hub.  Each opcode has a reply latency
+ * and jitter so timing resembles the real USB link.
+ *
+ * There is one hub per process (psEmulator()), like the real device,
+ * no matter how many PSCTL/transports talk to it.
+ */
+class PSEmulator
+{
+    public:
+        PSEmulator();
+
+        /**
+         * @brief configure Apply a PS_EMULATE setting, comma separated key=value:
+         *        latency=us, jitter=us (all opcodes), open=us (session open cost),
+         *        seed=n, 0xNN=us[/us] (latency/jitter of one opcode).
+         *        Anything else (e.g. "1") keeps the defaults.
+         */
+        void     configure(const char *spec);
+        void     setLatency(uint32_t latencyUs, uint32_t jitterUs);
+        void     setLatency(uint8_t opcode, uint32_t latencyUs, uint32_t jitterUs);
+        // a session is opened, returns what that costs (us)
+        uint32_t openSession() { lock_guard<mutex> l(lock); opens++; return openUs; }
+
+        /**
+         * @brief command Run one command against the hub
+         * @param cmd command bytes as written by PSCTL::hidCMD
+         * @param res receives the 3 byte reply
+         * @return microseconds until the reply is available
+         */
+        uint32_t command(const uint8_t *cmd, int len, uint8_t res[3]);
+
+        // back to power on state (NVM is kept)
+        void     powerOn();
+
+        // test hooks
+        void     setLoad(uint8_t ch, float amps);      // full load of a PS_CH_*_AMPS channel
+        void     setInputVolts(float volts) { lock_guard<mutex> l(lock); inVolts = volts; }
+        void     setWeather(float tempC, float hum);
+        void     setDrift(double cPerSec);                 // temperature change from now on
+        void     injectFault(uint16_t fault1, uint16_t fault2);
+        void     setPresent(bool present) { lock_guard<mutex> l(lock); plugged = present; }
+        bool     isPresent() { lock_guard<mutex> l(lock); return plugged; }
+        void     dropReplies(uint32_t n) { lock_guard<mutex> l(lock); drops += n; }
+        bool     takeDrop();                           // true: lose this reply
+
+        uint32_t position();
+        uint32_t commandCount() { lock_guard<mutex> l(lock); return commands; }
+        uint32_t openCount() { lock_guard<mutex> l(lock); return opens; }
+        uint32_t nvmWriteCount() { lock_guard<mutex> l(lock); return nvmWrites; }
+
+    private:
+        void     updateMotion(psEmuTime now);
+        void     updateWeather(psEmuTime now);
+        void     startMove(uint32_t target, psEmuTime now);
+        uint16_t adcVolts(uint8_t idx);
+        uint16_t adcCurrent(uint8_t idx);
+        uint32_t delay(uint8_t opcode);
+
+        mutex    lock;
+
+        // timing
+        uint32_t latencyUs[256];
+        uint32_t jitterUs[256];
+        uint32_t openUs { 0 };
+        uint32_t rng { 0x2545F491 };
+
+        // hub
+        bool     plugged { true };
+        psEmuNVM nvm;
+        psEmuNVM live;
+        uint16_t portMask { 0 };
+        uint16_t fault1 { 0 };
+        uint16_t fault2 { 0 };
+        bool     mtrLocked { true };
+        uint32_t commands { 0 };
+        uint32_t opens { 0 };
+        uint32_t nvmWrites { 0 };
+        uint32_t drops { 0 };
+
+        // loads and environment
+        float    fullAmps[PS_CH_N];
+        float    inVolts { 12.6 };
+        float    tempC_ { 12 };
+        float    hum_ { 65 };
+        double   driftCPerSec { 0 };
+        float    driftBase { 12 };
+        psEmuTime driftFrom;
+
+        // firmware temperature compensation, compensated up to this
+        // temperature, looked at once a second
+        bool     tcRefSet { false };
+        float    tcRefC { 0 };
+        psEmuTime tcNext;
+
+        // focuser, position is fractional while moving
+        double   pos { 50000 };
+        uint32_t staged { 0 };
+        uint8_t  stagedHigh { 0 };
+        bool     moving { false };
+        double   moveFrom { 0 };
+        double   moveVia { 0 };            // backlash turnaround, moveTo if none
+        double   legTo { 0 };              // end of the leg being run
+        uint32_t moveTo { 0 };
+        psEmuTime moveStart;
+};
+
+PSEmulator &psEmulator();
+
+// PSTransport onto a PSEmulator, sleeps out the reply latency in read()
+class PSEmuTransport : public PSTransport
+{
+    public:
+        PSEmuTransport(PSEmulator &e) : emu(e) {}
+
+        bool open();
+        void close() { opened = false; }
+        bool isOpen() { return opened; }
+        int  write(const uint8_t *cmd, int len);
+        int  read(uint8_t *res, int len, int timeoutMs);
+
+    private:
+        PSEmulator &emu;
+        bool     opened { false };
+        bool     pending { false };
+        uint8_t  reply[3] {};
+        psEmuTime ready;
+};
@@ -0,0 +1,69 @@
+/***************************************************************
+*  Program:      PSenergy.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star per port energy metering
+*
+*  Integrates current and power with the trapezoid rule over the
+*  monotonic time between readings, so it does not care how long
+*  a tick takes or what the poll period currently is.
+****************************************************************/
+
+#include "PSenergy.h"
+
+using namespace std;
+
+const char *PSEnergy::portName[PS_E_N] = { "IN", "Out1", "Out2", "Out3", "Out4", "Var", "MP", "Dew1", "Dew2" };
+
+// current channel of each port
+static const uint8_t portAmps[PSEnergy::PS_E_N] = {
+    PS_CH_IN_AMPS, PS_CH_OUT1_AMPS, PS_CH_OUT2_AMPS, PS_CH_OUT3_AMPS, PS_CH_OUT4_AMPS,
+    PS_CH_VAR_AMPS, PS_CH_MP_AMPS, PS_CH_DEW1_AMPS, PS_CH_DEW2_AMPS
+};
+
+PSEnergy::PSEnergy()
+{
+    reset();
+}
+
+//******************************************************************
+void PSEnergy::reset()
+{
+    for (int p = 0; p < PS_E_N; p++)
+        ampHrs[p] = wattHrs[p] = 0;
+    haveLast = false;
+}
+
+//******************************************************************
+void PSEnergy::sample(const struct timespec &mono, const float values[PS_CH_N])
+{
+    float amps[PS_E_N];
+    float watts[PS_E_N];
+
+    // everything but the variable output is switched straight from the input
+    for (int p = 0; p < PS_E_N; p++)
+    {
+        amps[p] = values[portAmps[p]];
+        watts[p] = amps[p] * values[p == PS_E_VAR ? PS_CH_VAR_VOLTS : PS_CH_IN_VOLTS];
+    }
+
+    double dt = (mono.tv_sec - last.tv_sec) + (mono.tv_nsec - last.tv_nsec) / 1e9;
+
+    if (haveLast && dt > 0 && dt <= PS_ENERGY_MAX_GAP)
+    {
+        double hours = dt / 3600.0;
+        for (int p = 0; p < PS_E_N; p++)
+        {
+            ampHrs[p] += (lastAmps[p] + amps[p]) / 2 * hours;
+            wattHrs[p] += (lastWatts[p] + watts[p]) / 2 * hours;
+        }
+    }
+
+    for (int p = 0; p < PS_E_N; p++)
+    {
+        lastAmps[p] = amps[p];
+        lastWatts[p] = watts[p];
+    }
+    last = mono;
+    haveLast = true;
+}
@@ -0,0 +1,57 @@
+/********************************************************
+*  Program:      PSenergy.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star per port energy metering
+*********************************************************/
+
+#pragma once
+
+#include "PSchannels.h"
+#include <stdint.h>
+#include <time.h>
+
+// a gap longer than this (disconnect, stalled driver) is not integrated
+#define PS_ENERGY_MAX_GAP   60.0
+
+class PSEnergy
+{
+    public:
+        // metered ports
+        typedef enum { PS_E_IN,
+                   PS_E_OUT1,
+                   PS_E_OUT2,
+                   PS_E_OUT3,
+                   PS_E_OUT4,
+                   PS_E_VAR,
+                   PS_E_MP,
+                   PS_E_DEW1,
+                   PS_E_DEW2,
+                   PS_E_N
+                 } PS_ENERGY_PORT;
+
+        static const char *portName[PS_E_N];
+
+        PSEnergy();
+
+        /**
+         * @brief sample Add one getStatus() reading
+         * @param mono CLOCK_MONOTONIC time the reading was taken
+         * @param values PSCTL::chanValue
+         */
+        void    sample(const struct timespec &mono, const float values[PS_CH_N]);
+
+        // zero the totals, the next sample starts a new integration
+        void    reset();
+        // forget the last sample, e.g. across a disconnect
+        void    restart() { haveLast = false; }
+
+        double  ampHrs[PS_E_N];
+        double  wattHrs[PS_E_N];
+
+    private:
+        bool    haveLast { false };
+        struct timespec last {};
+        float   lastAmps[PS_E_N];
+        float   lastWatts[PS_E_N];
+};
@@ -0,0 +1,373 @@
+/***************************************************************
+*  Program:      PSexport.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star compressed columnar telemetry export
+*
+*  Rows are buffered a block at a time, then each column is
+*  delta + zigzag varint packed and the block deflated.  ADC
+*  counts barely move between samples so most values pack into
+*  one byte before zlib even sees them.
+****************************************************************/
+
+#include "PSexport.h"
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+using namespace std;
+
+//******************************************************************
+static uint8_t *putVarint(uint8_t *p, int64_t v)
+{
+    uint64_t u = (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+    while (u >= 0x80)
+    {
+        *p++ = uint8_t(u) | 0x80;
+        u >>= 7;
+    }
+    *p++ = uint8_t(u);
+    return p;
+}
+
+//******************************************************************
+static bool getVarint(const uint8_t *&p, const uint8_t *end, int64_t *v)
+{
+    uint64_t u = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (p >= end)
+            return false;
+        uint8_t b = *p++;
+        u |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            *v = int64_t(u >> 1) ^ -int64_t(u & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+PSExport::PSExport()
+{
+    times.resize(PS_EXPORT_ROWS);
+    columns.resize(PS_EXPORT_ROWS * PS_CH_N);
+    // worst case is a 10 byte time delta and 3 bytes per count
+    packed.resize(PS_EXPORT_ROWS * (10 + 3 * PS_CH_N));
+    deflated.resize(compressBound(packed.size()));
+    index.reserve(PS_EXPORT_BLOCKS);
+}
+
+PSExport::~PSExport()
+{
+    close();
+}
+
+//******************************************************************
+bool PSExport::open(const string &dir)
+{
+    struct timespec now;
+    struct tm tmv;
+    char name[64];
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    gmtime_r(&now.tv_sec, &tmv);
+    strftime(name, sizeof(name), "/powerstar-%Y%m%d-%H%M%S" PS_EXPORT_EXT, &tmv);
+
+    mkdir(dir.c_str(), 0755);
+    return openFile(dir + name);
+}
+
+//******************************************************************
+bool PSExport::openFile(const string &fpath)
+{
+    close();
+
+    fp = fopen(fpath.c_str(), "wbe");
+    if (fp == nullptr)
+        return false;
+    path = fpath;
+
+    psExportHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    strncpy(hdr.magic, PS_EXPORT_MAGIC, sizeof(hdr.magic));
+    hdr.channels = PS_CH_N;
+
+    rows = 0;
+    index.clear();
+
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+    {
+        fclose(fp);
+        fp = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+//******************************************************************
+bool PSExport::close()
+{
+    if (fp == nullptr)
+        return true;
+
+    bool ok = writeBlock();
+
+    psExportTrailer trailer;
+    trailer.indexOffset = ftell(fp);
+    trailer.blocks = index.size();
+    trailer.magic = PS_EXPORT_IDXMAGIC;
+
+    if (!index.empty() && fwrite(index.data(), sizeof(psExportIndex), index.size(), fp) != index.size())
+        ok = false;
+    if (fwrite(&trailer, sizeof(trailer), 1, fp) != 1)
+        ok = false;
+
+    if (fclose(fp) != 0)
+        ok = false;
+    fp = nullptr;
+
+    return ok;
+}
+
+//******************************************************************
+bool PSExport::append(int64_t timeMs, const uint16_t raw[PS_CH_N])
+{
+    if (fp == nullptr)
+        return false;
+
+    times[rows] = timeMs;
+    for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+        columns[ch * PS_EXPORT_ROWS + rows] = raw[ch];
+
+    if (++rows < PS_EXPORT_ROWS)
+        return true;
+
+    return writeBlock();
+}
+
+//******************************************************************
+bool PSExport::writeBlock()
+{
+    if (rows == 0)
+        return true;
+
+    uint8_t *p = packed.data();
+    int64_t prev = times[0];
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        p = putVarint(p, times[r] - prev);
+        prev = times[r];
+    }
+
+    for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+    {
+        const uint16_t *col = &columns[ch * PS_EXPORT_ROWS];
+        int64_t last = 0;
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            p = putVarint(p, int64_t(col[r]) - last);
+            last = col[r];
+        }
+    }
+
+    uLongf clen = deflated.size();
+    uLong rlen = p - packed.data();
+    if (compress2(deflated.data(), &clen, packed.data(), rlen, Z_BEST_COMPRESSION) != Z_OK)
+        return false;
+
+    psExportBlock blk;
+    blk.magic = PS_EXPORT_BLKMAGIC;
+    blk.rows = rows;
+    blk.firstMs = times[0];
+    blk.lastMs = times[rows - 1];
+    blk.clen = clen;
+    blk.rlen = rlen;
+
+    psExportIndex idx;
+    idx.firstMs = blk.firstMs;
+    idx.lastMs = blk.lastMs;
+    idx.offset = ftell(fp);
+
+    rows = 0;
+
+    if (fwrite(&blk, sizeof(blk), 1, fp) != 1 || fwrite(deflated.data(), 1, clen, fp) != clen)
+        return false;
+
+    // hand the block to the kernel so a crash only loses the rows in memory
+    fflush(fp);
+    index.push_back(idx);
+    return true;
+}
+
+/***************************************************************/
+/* Reader                                                      */
+/***************************************************************/
+PSExportReader::PSExportReader() {}
+
+PSExportReader::~PSExportReader()
+{
+    close();
+}
+
+//******************************************************************
+bool PSExportReader::open(const char *path)
+{
+    close();
+
+    fp = fopen(path, "rbe");
+    if (fp == nullptr)
+        return false;
+
+    psExportHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+            strncmp(hdr.magic, PS_EXPORT_MAGIC, sizeof(hdr.magic)) != 0 || hdr.channels == 0)
+    {
+        close();
+        return false;
+    }
+    channels = hdr.channels;
+
+    // use the index when the file was closed cleanly
+    psExportTrailer trailer;
+    if (fseek(fp, -long(sizeof(trailer)), SEEK_END) == 0 &&
+            fread(&trailer, sizeof(trailer), 1, fp) == 1 && trailer.magic == PS_EXPORT_IDXMAGIC)
+    {
+        index.resize(trailer.blocks);
+        if (trailer.blocks == 0)
+            return true;
+        if (fseek(fp, trailer.indexOffset, SEEK_SET) == 0 &&
+                fread(index.data(), sizeof(psExportIndex), index.size(), fp) == index.size())
+            return true;
+    }
+
+    return scanBlocks();
+}
+
+//******************************************************************
+// No index, walk the block headers up to the first incomplete block
+bool PSExportReader::scanBlocks()
+{
+    index.clear();
+    index.reserve(PS_EXPORT_BLOCKS);
+
+    if (fseek(fp, 0, SEEK_END) != 0)
+        return false;
+    long size = ftell(fp);
+    long offset = sizeof(psExportHeader);
+
+    psExportBlock blk;
+    while (fseek(fp, offset, SEEK_SET) == 0 && fread(&blk, sizeof(blk), 1, fp) == 1)
+    {
+        if (blk.magic != PS_EXPORT_BLKMAGIC || offset + long(sizeof(blk)) + long(blk.clen) > size)
+            break;
+
+        psExportIndex idx;
+        idx.firstMs = blk.firstMs;
+        idx.lastMs = blk.lastMs;
+        idx.offset = offset;
+        index.push_back(idx);
+
+        offset += sizeof(blk) + blk.clen;
+    }
+
+    return true;
+}
+
+//******************************************************************
+void PSExportReader::close()
+{
+    if (fp != nullptr)
+        fclose(fp);
+    fp = nullptr;
+    index.clear();
+}
+
+//******************************************************************
+bool PSExportReader::read(int64_t fromMs, int64_t toMs, vector<int64_t> &times, vector<uint16_t> &raw)
+{
+    if (fp == nullptr)
+        return false;
+
+    for (const psExportIndex &blk : index)
+    {
+        if (blk.lastMs < fromMs || blk.firstMs > toMs)
+            continue;
+        if (!readBlock(blk, fromMs, toMs, times, raw))
+            return false;
+    }
+
+    return true;
+}
+
+//******************************************************************
+bool PSExportReader::readBlock(const psExportIndex &idx, int64_t fromMs, int64_t toMs,
+                               vector<int64_t> &times, vector<uint16_t> &raw)
+{
+    psExportBlock blk;
+    if (fseek(fp, idx.offset, SEEK_SET) != 0 || fread(&blk, sizeof(blk), 1, fp) != 1 ||
+            blk.magic != PS_EXPORT_BLKMAGIC)
+        return false;
+
+    deflated.resize(blk.clen);
+    packed.resize(blk.rlen);
+    if (fread(deflated.data(), 1, blk.clen, fp) != blk.clen)
+        return false;
+
+    uLongf rlen = blk.rlen;
+    if (uncompress(packed.data(), &rlen, deflated.data(), blk.clen) != Z_OK || rlen != blk.rlen)
+        return false;
+
+    const uint8_t *p = packed.data();
+    const uint8_t *end = p + rlen;
+    size_t first = times.size();
+
+    times.resize(first + blk.rows);
+    raw.resize((first + blk.rows) * PS_CH_N);
+
+    int64_t t = blk.firstMs;
+    for (uint32_t r = 0; r < blk.rows; r++)
+    {
+        int64_t d;
+        if (!getVarint(p, end, &d))
+            return false;
+        t += d;
+        times[first + r] = t;
+    }
+
+    // columns from a newer writer are decoded and dropped
+    for (uint32_t ch = 0; ch < channels; ch++)
+    {
+        int64_t v = 0;
+        for (uint32_t r = 0; r < blk.rows; r++)
+        {
+            int64_t d;
+            if (!getVarint(p, end, &d))
+                return false;
+            v += d;
+            if (ch < PS_CH_N)
+                raw[(first + r) * PS_CH_N + ch] = uint16_t(v);
+        }
+    }
+
+    // drop the rows outside the range, the rows are in time order
+    size_t out = first;
+    for (size_t r = first; r < times.size(); r++)
+    {
+        if (times[r] < fromMs || times[r] > toMs)
+            continue;
+        if (out != r)
+        {
+            times[out] = times[r];
+            memcpy(&raw[out * PS_CH_N], &raw[r * PS_CH_N], PS_CH_N * sizeof(uint16_t));
+        }
+        out++;
+    }
+    times.resize(out);
+    raw.resize(out * PS_CH_N);
+
+    return true;
+}
@@ -0,0 +1,127 @@
+/********************************************************
+*  Program:      PSexport.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star compressed columnar telemetry export
+*********************************************************/
+
+#pragma once
+
+#include "PSchannels.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// File layout (host byte order):
+//   psExportHeader
+//   blocks: psExportBlock + 'clen' bytes of deflated column data
+//   index:  psExportIndex per block (written on close)
+//   psExportTrailer
+// A block's column data is the timestamp column then one column per
+// channel, each value stored as the zigzag varint of its delta from
+// the previous row.  A file left without an index (driver killed) is
+// still readable by walking the block headers.
+#define PS_EXPORT_MAGIC     "PSCOL1"
+#define PS_EXPORT_BLKMAGIC  0x42435350      // "PSCB"
+#define PS_EXPORT_IDXMAGIC  0x58435350      // "PSCX"
+#define PS_EXPORT_EXT       ".psc"
+#define PS_EXPORT_ROWS      3600            // rows per block
+#define PS_EXPORT_BLOCKS    1024            // index entries reserved, 6 weeks of 1 s polls
+
+typedef struct {
+            char     magic[8];
+            uint32_t channels;         // PS_CH_N of the writer
+            uint32_t reserved;
+} psExportHeader;
+
+typedef struct {
+            uint32_t magic;            // PS_EXPORT_BLKMAGIC
+            uint32_t rows;
+            int64_t  firstMs;          // unix ms of the first and last row
+            int64_t  lastMs;
+            uint32_t clen;             // deflated size that follows
+            uint32_t rlen;             // size once inflated
+} psExportBlock;
+
+typedef struct {
+            int64_t  firstMs;
+            int64_t  lastMs;
+            uint64_t offset;           // file offset of the psExportBlock
+} psExportIndex;
+
+typedef struct {
+            uint64_t indexOffset;
+            uint32_t blocks;
+            uint32_t magic;            // PS_EXPORT_IDXMAGIC
+} psExportTrailer;
+
+class PSExport
+{
+    public:
+        PSExport();
+        ~PSExport();
+
+        /**
+         * @brief open Start a new export file in a directory
+         * @param dir directory for the export file (created if missing)
+         * @return True if the file could be created
+         */
+        bool    open(const string &dir);
+        bool    openFile(const string &path);
+        // writes the partial block, index and trailer
+        bool    close();
+        bool    isOpen() { return fp != nullptr; }
+
+        // buffers a row, deflates and writes a block every PS_EXPORT_ROWS rows
+        bool    append(int64_t timeMs, const uint16_t raw[PS_CH_N]);
+
+        const string &fileName() { return path; }
+
+    private:
+        bool    writeBlock();
+
+        FILE    *fp { nullptr };
+        string   path;
+
+        // one block of rows, sized once in the constructor
+        vector<int64_t>  times;
+        vector<uint16_t> columns;      // PS_CH_N columns of PS_EXPORT_ROWS
+        uint32_t rows { 0 };
+
+        vector<uint8_t>  packed;
+        vector<uint8_t>  deflated;
+        vector<psExportIndex> index;
+};
+
+class PSExportReader
+{
+    public:
+        PSExportReader();
+        ~PSExportReader();
+
+        bool    open(const char *path);
+        void    close();
+
+        /**
+         * @brief read Decode the rows of the blocks overlapping a time range
+         * @param fromMs,toMs unix ms, only blocks that overlap are inflated
+         * @param times receives the row times, rows outside the range are dropped
+         * @param raw receives PS_CH_N counts per row
+         * @return False if a block is damaged
+         */
+        bool    read(int64_t fromMs, int64_t toMs, vector<int64_t> &times, vector<uint16_t> &raw);
+
+    private:
+        bool    scanBlocks();
+        bool    readBlock(const psExportIndex &blk, int64_t fromMs, int64_t toMs,
+                          vector<int64_t> &times, vector<uint16_t> &raw);
+
+        FILE    *fp { nullptr };
+        uint32_t channels { 0 };
+        vector<psExportIndex> index;
+        vector<uint8_t> deflated;
+        vector<uint8_t> packed;
+};
@@ -0,0 +1,263 @@
+/***************************************************************
+*  Program:      PSfocuslog.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star focus run log
+****************************************************************/
+
+#include "PSfocuslog.h"
+#include <math.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+using namespace std;
+
+// order of the file: filter name, then temperature
+static int compareKey(const char *fa, float ta, const char *fb, float tb)
+{
+    int c = strncmp(fa, fb, PS_FOCUSLOG_FILTER);
+    if (c)
+        return c;
+    return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+PSFocusLog::~PSFocusLog()
+{
+    close();
+}
+
+//******************************************************************
+bool PSFocusLog::open(const string &logPath)
+{
+    close();
+    path = logPath;
+
+    string dir = path.substr(0, path.rfind('/'));
+    mkdir(dir.c_str(), 0755);
+
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno == ENOENT;
+
+    psFocusLogHeader hdr;
+    struct stat st;
+    if (pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || fstat(fd, &st) != 0 ||
+            strncmp(hdr.magic, PS_FOCUSLOG_MAGIC, sizeof(hdr.magic)) != 0 ||
+            hdr.recordSize != sizeof(psFocusRecord))
+    {
+        close();
+        return false;
+    }
+
+    // never trust the count past what is actually there
+    off_t have = (st.st_size - off_t(sizeof(hdr))) / off_t(sizeof(psFocusRecord));
+    count = uint32_t(min(off_t(hdr.count), max(have, off_t(0))));
+
+    return buildIndex();
+}
+
+//******************************************************************
+void PSFocusLog::close()
+{
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    count = 0;
+    index.clear();
+}
+
+//******************************************************************
+bool PSFocusLog::buildIndex()
+{
+    psFocusRecord r;
+
+    index.clear();
+    for (uint32_t i = 0; i < count; i += PS_FOCUSLOG_STRIDE)
+    {
+        if (!read(i, &r))
+        {
+            close();
+            return false;
+        }
+        indexEntry e;
+        memcpy(e.filter, r.filter, sizeof(e.filter));
+        e.tempC = r.tempC;
+        index.push_back(e);
+    }
+    return true;
+}
+
+//******************************************************************
+bool PSFocusLog::read(uint32_t i, psFocusRecord *r)
+{
+    off_t at = off_t(sizeof(psFocusLogHeader)) + off_t(i) * off_t(sizeof(psFocusRecord));
+    return pread(fd, r, sizeof(*r), at) == sizeof(*r);
+}
+
+//******************************************************************
+// First record at or after (filter, tempC)
+uint32_t PSFocusLog::lowerBound(const char *filter, float tempC)
+{
+    // first index entry at or after the key; the answer is in the block
+    // before it, or is that entry itself
+    size_t lo = 0, hi = index.size();
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (compareKey(index[mid].filter, index[mid].tempC, filter, tempC) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return 0;
+
+    uint32_t base = uint32_t(lo - 1) * PS_FOCUSLOG_STRIDE;
+    uint32_t n = min(count - base, uint32_t(PS_FOCUSLOG_STRIDE));
+    psFocusRecord block[PS_FOCUSLOG_STRIDE];
+    off_t at = off_t(sizeof(psFocusLogHeader)) + off_t(base) * off_t(sizeof(psFocusRecord));
+    ssize_t got = pread(fd, block, n * sizeof(psFocusRecord), at);
+    if (got < 0)
+        return base;
+    n = min(n, uint32_t(got / sizeof(psFocusRecord)));
+
+    // block[0] is the index entry, known to sort before the key
+    for (uint32_t i = 1; i < n; i++)
+        if (compareKey(block[i].filter, block[i].tempC, filter, tempC) >= 0)
+            return base + i;
+    return base + n;
+}
+
+//******************************************************************
+bool PSFocusLog::range(const char *filter, uint32_t *first, uint32_t *end)
+{
+    *first = lowerBound(filter, -INFINITY);
+    *end = lowerBound(filter, INFINITY);
+    return *first < *end;
+}
+
+//******************************************************************
+bool PSFocusLog::predict(const char *filter, float tempC, uint32_t *pos, float *dT)
+{
+    char key[PS_FOCUSLOG_FILTER] = {};
+    uint32_t first, end;
+
+    if (fd < 0 || count == 0)
+        return false;
+
+    // the offset between filters is unknown, so another filter's entries
+    // would only mislead; entries without a wheel are the one fallback
+    strncpy(key, filter ? filter : "", sizeof(key) - 1);
+    if (!range(key, &first, &end))
+    {
+        if (!key[0])
+            return false;
+        key[0] = 0;
+        if (!range(key, &first, &end))
+            return false;
+    }
+
+    // walk out from where tempC would sit, nearest temperature first
+    uint32_t right = min(max(lowerBound(key, tempC), first), end);
+    uint32_t left = right;
+    psFocusRecord l, r;
+    bool haveL = left > first && read(left - 1, &l);
+    bool haveR = right < end && read(right, &r);
+
+    double sw = 0, st = 0, sp = 0, stt = 0, stp = 0;
+    double tMin = INFINITY, tMax = -INFINITY, far = 0;
+    for (int n = 0; n < PS_FOCUSLOG_NEAREST && (haveL || haveR); n++)
+    {
+        psFocusRecord e;
+        if (haveL && (!haveR || tempC - l.tempC <= r.tempC - tempC))
+        {
+            e = l;
+            left--;
+            haveL = left > first && read(left - 1, &l);
+        }
+        else
+        {
+            e = r;
+            right++;
+            haveR = right < end && read(right, &r);
+        }
+
+        // a sharper run is the better estimate of best focus
+        double w = e.hfr > 0 ? 1.0 / e.hfr : 1.0;
+        double t = e.tempC - tempC;
+        sw += w;
+        st += w * t;
+        sp += w * e.position;
+        stt += w * t * t;
+        stp += w * t * e.position;
+        tMin = min(tMin, double(e.tempC));
+        tMax = max(tMax, double(e.tempC));
+        far = max(far, fabs(t));
+    }
+    if (sw <= 0)
+        return false;
+
+    // temperatures are taken relative to tempC, so the intercept is the
+    // prediction
+    double p = sp / sw;
+    double det = sw * stt - st * st;
+    if (tMax - tMin >= PS_FOCUSLOG_SPAN && det > 0)
+        p = (sp * stt - st * stp) / det;
+
+    *pos = uint32_t(lround(max(p, 0.0)));
+    *dT = float(far);
+    return true;
+}
+
+//******************************************************************
+bool PSFocusLog::add(const psFocusRecord &rec)
+{
+    if (!isfinite(rec.tempC) || path.empty())
+        return false;
+
+    psFocusRecord r = rec;
+    r.filter[PS_FOCUSLOG_FILTER - 1] = 0;
+
+    // once per autofocus run, so simply read it all and write it back
+    vector<psFocusRecord> all(count);
+    off_t body = off_t(sizeof(psFocusLogHeader));
+    if (count && pread(fd, all.data(), count * sizeof(psFocusRecord), body) !=
+            ssize_t(count * sizeof(psFocusRecord)))
+        return false;
+
+    auto at = upper_bound(all.begin(), all.end(), r,
+                          [](const psFocusRecord & a, const psFocusRecord & b)
+    {
+        return compareKey(a.filter, a.tempC, b.filter, b.tempC) < 0;
+    });
+    all.insert(at, r);
+
+    psFocusLogHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    strncpy(hdr.magic, PS_FOCUSLOG_MAGIC, sizeof(hdr.magic));
+    hdr.recordSize = sizeof(psFocusRecord);
+    hdr.count = uint32_t(all.size());
+
+    string tmp = path + ".tmp";
+    int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0)
+        return false;
+
+    size_t bytes = all.size() * sizeof(psFocusRecord);
+    bool ok = write(out, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+              write(out, all.data(), bytes) == ssize_t(bytes) &&
+              fsync(out) == 0;
+    ok = (::close(out) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    return open(path);
+}
@@ -0,0 +1,90 @@
+/********************************************************
+*  Program:      PSfocuslog.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star focus run log
+*********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// File layout (host byte order):
+//   psFocusLogHeader, then psFocusRecords sorted by filter, then
+//   temperature.  A new record rewrites the file (to a temporary that
+//   is renamed over it), once per autofocus run, so a reader never
+//   sees it half written.
+#define PS_FOCUSLOG_MAGIC   "PSFLOG1"
+#define PS_FOCUSLOG_FILTER  16          // filter name bytes, NUL padded
+#define PS_FOCUSLOG_STRIDE  32          // records per index entry
+#define PS_FOCUSLOG_NEAREST 4           // entries a prediction is made from
+#define PS_FOCUSLOG_SPAN    1.0         // C those need for a slope
+#define PS_FOCUSLOG_REDO    0.1         // C of drift before the prediction is redone
+
+typedef struct {
+            char     magic[8];
+            uint32_t recordSize;
+            uint32_t count;
+            uint8_t  reserved[16];
+} psFocusLogHeader;
+
+typedef struct {
+            char     filter[PS_FOCUSLOG_FILTER];   // "" without a snooped filter wheel
+            float    tempC;
+            float    humidity;
+            float    hfr;                          // 0 when the client gave none
+            uint32_t position;                     // best focus
+            int64_t  timeSec;                      // unix
+} psFocusRecord;
+
+/**
+ * Past autofocus results, kept sorted on disk.  Only every
+ * PS_FOCUSLOG_STRIDE'th key is held in memory; a lookup binary searches
+ * that, reads one block, then walks out to the nearest temperatures
+ * with single record reads.
+ */
+class PSFocusLog
+{
+    public:
+        ~PSFocusLog();
+
+        // a missing file is an empty log
+        bool    open(const string &path);
+        void    close();
+
+        bool    add(const psFocusRecord &r);
+        uint32_t size() { return count; }
+
+        /**
+         * @brief predict Best focus at a temperature from the nearest entries
+         * @param filter entries of this filter, or those without one if it has none
+         * @param pos receives the position: a line through the
+         *        PS_FOCUSLOG_NEAREST nearest entries if they span
+         *        PS_FOCUSLOG_SPAN, else their average (weighted by 1/HFR)
+         * @param dT receives the temperature distance to the farthest entry used
+         * @return false without entries to go on
+         */
+        bool    predict(const char *filter, float tempC, uint32_t *pos, float *dT);
+
+    private:
+        struct indexEntry
+        {
+            char    filter[PS_FOCUSLOG_FILTER];
+            float   tempC;
+        };
+
+        bool    read(uint32_t i, psFocusRecord *r);
+        uint32_t lowerBound(const char *filter, float tempC);
+        bool    range(const char *filter, uint32_t *first, uint32_t *end);
+        bool    buildIndex();
+
+        string   path;
+        int      fd { -1 };
+        uint32_t count { 0 };
+        vector<indexEntry> index;
+};
@@ -0,0 +1,144 @@
+/***************************************************************
+*  Program:      PShistory.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star telemetry history rings
+*
+*  Every channel keeps a fixed ring of min/max/mean buckets at
+*  each resolution.  All channels are sampled together by
+*  getStatus() so they share the ring heads, and a sample only
+*  touches the current bucket of each ring (O(1) per sample).
+****************************************************************/
+
+#include "PShistory.h"
+#include <stdio.h>
+#include <algorithm>
+
+using namespace std;
+
+const uint32_t PSHistory::resWidth[PS_RES_N] = { 1, 60, 600 };
+const uint32_t PSHistory::resDepth[PS_RES_N] = { 3600, 1440, 1008 };
+
+static const char *resNames[PSHistory::PS_RES_N] = { "1s", "1m", "10m" };
+
+// "unix time,min,max,mean\n" with room to spare
+static const size_t ROW_SIZE = 64;
+
+PSHistory::PSHistory()
+{
+    size_t total = 0;
+    for (int r = 0; r < PS_RES_N; r++)
+    {
+        ringOffset[r] = total;
+        total += resDepth[r] * PS_CH_N;
+    }
+
+    buckets.resize(total);
+    clear();
+}
+
+//******************************************************************
+void PSHistory::clear()
+{
+    fill(buckets.begin(), buckets.end(), bucket());
+
+    for (int r = 0; r < PS_RES_N; r++)
+    {
+        head[r] = 0;
+        empty[r] = true;
+        curStart[r] = 0;
+    }
+}
+
+//******************************************************************
+void PSHistory::addSample(time_t now, const float values[PS_CH_N])
+{
+    for (int r = 0; r < PS_RES_N; r++)
+    {
+        int32_t start = (int32_t)(now - (now % resWidth[r]));
+        bool newBucket = empty[r] || start != curStart[r];
+
+        if (newBucket)
+        {
+            if (!empty[r])
+                head[r] = (head[r] + 1) % resDepth[r];
+            empty[r] = false;
+            curStart[r] = start;
+        }
+
+        for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+        {
+            bucket &b = ring(ch, r)[head[r]];
+            float v = values[ch];
+
+            if (newBucket)
+            {
+                b.t = start;
+                b.min = b.max = b.sum = v;
+                b.count = 1;
+                continue;
+            }
+
+            if (v < b.min)
+                b.min = v;
+            if (v > b.max)
+                b.max = v;
+            b.sum += v;
+            b.count++;
+        }
+    }
+}
+
+//******************************************************************
+size_t PSHistory::maxQuerySize()
+{
+    return (resDepth[PS_RES_1S] + 1) * ROW_SIZE;
+}
+
+//******************************************************************
+size_t PSHistory::query(uint8_t channel, uint8_t res, time_t from, time_t to, char *buf, size_t buflen)
+{
+    if (channel >= PS_CH_N || buflen == 0)
+        return 0;
+
+    // pick the finest resolution that still reaches back to 'from'
+    if (res >= PS_RES_N)
+    {
+        res = PS_RES_10M;
+        for (int r = 0; r < PS_RES_N; r++)
+        {
+            if (empty[r])
+                continue;
+            uint32_t oldest = (head[r] + 1) % resDepth[r];
+            bucket *rb = ring(channel, r);
+            time_t first = rb[oldest].count ? rb[oldest].t : rb[0].t;
+            if (first <= from)
+            {
+                res = r;
+                break;
+            }
+        }
+    }
+
+    size_t len = snprintf(buf, buflen, "# %s (%s) %s\ntime,min,max,mean\n",
+                          psChannels[channel].name, psChannels[channel].unit, resNames[res]);
+    if (len >= buflen || empty[res])
+        return len < buflen ? len : 0;
+
+    // walk the ring oldest to newest
+    bucket *rb = ring(channel, res);
+    for (uint32_t i = 1; i <= resDepth[res]; i++)
+    {
+        const bucket &b = rb[(head[res] + i) % resDepth[res]];
+        if (b.count == 0 || b.t < from || b.t > to)
+            continue;
+
+        if (buflen - len < ROW_SIZE)
+            break;
+
+        len += snprintf(buf + len, buflen - len, "%d,%.4f,%.4f,%.4f\n",
+                        b.t, b.min, b.max, b.sum / b.count);
+    }
+
+    return len;
+}
@@ -0,0 +1,71 @@
+/********************************************************
+*  Program:      PShistory.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star telemetry history rings
+*********************************************************/
+
+#pragma once
+
+#include "PSchannels.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <vector>
+
+using namespace std;
+
+class PSHistory
+{
+    public:
+
+        // Rollup resolutions, each one has its own ring per channel
+        typedef enum { PS_RES_1S,
+                   PS_RES_1M,
+                   PS_RES_10M,
+                   PS_RES_N
+                 } PS_RESOLUTION;
+
+        typedef struct
+        {
+            int32_t  t;           // start of the bucket (unix seconds)
+            float    min;
+            float    max;
+            float    sum;
+            uint32_t count;
+        } bucket;
+
+        // Bucket width (s) and ring depth for each resolution:
+        // 1 hour of 1s, 1 day of 1m and 1 week of 10m rollups
+        static const uint32_t resWidth[PS_RES_N];
+        static const uint32_t resDepth[PS_RES_N];
+
+        PSHistory();
+
+        void    addSample(time_t now, const float values[PS_CH_N]);
+        void    clear();
+
+        /**
+         * @brief query Write min/max/mean rows of one channel as CSV
+         * @param channel PS_CHANNEL to report
+         * @param res resolution to read, PS_RES_N picks the finest one that covers 'from'
+         * @param from, to time range (unix seconds, inclusive)
+         * @param buf, buflen output buffer, rows that do not fit are dropped
+         * @return number of bytes written
+         */
+        size_t  query(uint8_t channel, uint8_t res, time_t from, time_t to, char *buf, size_t buflen);
+
+        // size of the largest possible query result
+        static size_t maxQuerySize();
+
+    private:
+
+        bucket *ring(uint8_t channel, uint8_t res) { return &buckets[ringOffset[res] + channel * resDepth[res]]; }
+
+        // all rings live in one block allocated by the constructor
+        vector<bucket> buckets;
+        size_t   ringOffset[PS_RES_N];
+        uint32_t head[PS_RES_N];
+        bool     empty[PS_RES_N];
+        int32_t  curStart[PS_RES_N];
+};
@@ -0,0 +1,270 @@
+/***************************************************************
+*  Program:      PSjournal.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star telemetry journal
+*
+*  Samples are stored straight into a MAP_SHARED mapping of a
+*  pre-allocated segment file, so appending never waits on
+*  write(2) and the page cache keeps everything already written
+*  if the driver dies.
+****************************************************************/
+
+#include "PSjournal.h"
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+PSJournal::PSJournal() {}
+
+PSJournal::~PSJournal()
+{
+    close();
+}
+
+//******************************************************************
+bool PSJournal::open(const string &jdir, uint32_t segmentMB, uint32_t keepSegments)
+{
+    close();
+
+    dir = jdir;
+    keep = keepSegments;
+    segBytes = (size_t)(segmentMB ? segmentMB : 1) * 1024 * 1024;
+
+    mkdir(dir.c_str(), 0755);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    return newSegment(int64_t(now.tv_sec) * 1000 + now.tv_nsec / 1000000);
+}
+
+//******************************************************************
+void PSJournal::close()
+{
+    closeSegment();
+}
+
+//******************************************************************
+void PSJournal::closeSegment()
+{
+    if (map != nullptr)
+    {
+        // let the kernel write it back in its own time
+        msync(map, segBytes, MS_ASYNC);
+        munmap(map, segBytes);
+        map = nullptr;
+        records = nullptr;
+    }
+
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+//******************************************************************
+bool PSJournal::newSegment(int64_t timeMs)
+{
+    closeSegment();
+
+    time_t secs = timeMs / 1000;
+    struct tm tmv;
+    char name[64];
+    char msecs[8];
+    gmtime_r(&secs, &tmv);
+    strftime(name, sizeof(name), "/powerstar-%Y%m%d-%H%M%S", &tmv);
+    snprintf(msecs, sizeof(msecs), "-%03d", int(timeMs % 1000));
+    segPath = dir + name + msecs + PS_JOURNAL_EXT;
+
+    fd = ::open(segPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    // reserve the blocks now so a full disk can't fault the mapping later
+    if (posix_fallocate(fd, 0, segBytes) != 0)
+    {
+        closeSegment();
+        unlink(segPath.c_str());
+        return false;
+    }
+
+    void *m = mmap(nullptr, segBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED)
+    {
+        closeSegment();
+        unlink(segPath.c_str());
+        return false;
+    }
+    map = static_cast<uint8_t *>(m);
+
+    psJournalHeader *hdr = reinterpret_cast<psJournalHeader *>(map);
+    memset(hdr, 0, sizeof(*hdr));
+    strncpy(hdr->magic, PS_JOURNAL_MAGIC, sizeof(hdr->magic));
+    hdr->recordSize = sizeof(psJournalRecord);
+    hdr->channels = PS_CH_N;
+    hdr->baseTimeMs = timeMs;
+
+    records = reinterpret_cast<psJournalRecord *>(map + sizeof(psJournalHeader));
+    capacity = (segBytes - sizeof(psJournalHeader)) / sizeof(psJournalRecord);
+    next = 0;
+    baseTimeMs = timeMs;
+
+    if (keep)
+        pruneSegments();
+
+    return true;
+}
+
+//******************************************************************
+// Remove the oldest segments, the timestamped names sort by age
+void PSJournal::pruneSegments()
+{
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr)
+        return;
+
+    vector<string> segs;
+    size_t extLen = strlen(PS_JOURNAL_EXT);
+    struct dirent *de;
+    while ((de = readdir(d)) != nullptr)
+    {
+        size_t len = strlen(de->d_name);
+        if (strncmp(de->d_name, "powerstar-", 10) == 0 && len > extLen &&
+                strcmp(de->d_name + len - extLen, PS_JOURNAL_EXT) == 0)
+            segs.push_back(de->d_name);
+    }
+    closedir(d);
+
+    if (segs.size() <= keep)
+        return;
+
+    sort(segs.begin(), segs.end());
+    for (size_t i = 0; i < segs.size() - keep; i++)
+        unlink((dir + "/" + segs[i]).c_str());
+}
+
+//******************************************************************
+bool PSJournal::append(int64_t timeMs, const uint16_t raw[PS_CH_N])
+{
+    if (map == nullptr)
+        return false;
+
+    // rotate when this sample does not fit or the deltas would overflow
+    if (next + PS_CH_N > capacity || timeMs - baseTimeMs > 0xffffffffLL || timeMs < baseTimeMs)
+    {
+        if (!newSegment(timeMs))
+            return false;
+    }
+
+    uint32_t delta = uint32_t(timeMs - baseTimeMs);
+    for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+    {
+        psJournalRecord *rec = &records[next++];
+        rec->deltaMs = delta;
+        rec->raw = raw[ch];
+        rec->channel = ch;
+        // publish the record only after the rest of it is in place
+        __atomic_store_n(&rec->valid, (uint8_t)PS_JOURNAL_VALID, __ATOMIC_RELEASE);
+    }
+
+    return true;
+}
+
+/***************************************************************/
+/* Reader                                                      */
+/***************************************************************/
+PSJournalReader::PSJournalReader() {}
+
+PSJournalReader::~PSJournalReader()
+{
+    close();
+}
+
+//******************************************************************
+bool PSJournalReader::open(const char *path)
+{
+    close();
+
+    fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(psJournalHeader))
+    {
+        close();
+        return false;
+    }
+
+    mapSize = st.st_size;
+    void *m = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m == MAP_FAILED)
+    {
+        map = nullptr;
+        close();
+        return false;
+    }
+    map = static_cast<uint8_t *>(m);
+
+    const psJournalHeader *hdr = reinterpret_cast<const psJournalHeader *>(map);
+    if (strncmp(hdr->magic, PS_JOURNAL_MAGIC, sizeof(hdr->magic)) != 0 ||
+            hdr->recordSize != sizeof(psJournalRecord))
+    {
+        close();
+        return false;
+    }
+
+    records = reinterpret_cast<const psJournalRecord *>(map + sizeof(psJournalHeader));
+    capacity = (mapSize - sizeof(psJournalHeader)) / sizeof(psJournalRecord);
+    baseTimeMs = hdr->baseTimeMs;
+    pos = 0;
+
+    return true;
+}
+
+//******************************************************************
+void PSJournalReader::close()
+{
+    if (map != nullptr)
+        munmap(map, mapSize);
+    map = nullptr;
+    records = nullptr;
+
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
+//******************************************************************
+bool PSJournalReader::next(int64_t *timeMs, uint8_t *channel, uint16_t *raw)
+{
+    while (records != nullptr && pos < capacity)
+    {
+        const psJournalRecord &rec = records[pos];
+        if (rec.valid != PS_JOURNAL_VALID)
+            return false;
+        pos++;
+
+        // channels added by a newer driver are skipped
+        if (rec.channel >= PS_CH_N)
+            continue;
+
+        *timeMs = baseTimeMs + rec.deltaMs;
+        *channel = rec.channel;
+        *raw = rec.raw;
+        return true;
+    }
+
+    return false;
+}
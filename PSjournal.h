@@ -0,0 +1,101 @@
+/********************************************************
+*  Program:      PSjournal.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star telemetry journal
+*********************************************************/
+
+#pragma once
+
+#include "PSchannels.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+using namespace std;
+
+// Segment file layout (host byte order):
+//   psJournalHeader, then fixed size psJournalRecords up to the
+//   pre-allocated segment size.  Unused space stays zero, a record
+//   only counts once its 'valid' byte is set, and that byte is
+//   written last, so a crash can never leave a half record behind.
+#define PS_JOURNAL_MAGIC    "PSJRNL1"
+#define PS_JOURNAL_VALID    0xA5
+#define PS_JOURNAL_EXT      ".psj"
+
+typedef struct {
+            char     magic[8];
+            uint32_t recordSize;
+            uint32_t channels;         // PS_CH_N of the writer
+            int64_t  baseTimeMs;       // unix ms, records are relative to this
+            uint8_t  reserved[40];
+} psJournalHeader;
+
+typedef struct {
+            uint32_t deltaMs;
+            uint16_t raw;              // ADC counts as read from the Power*Star
+            uint8_t  channel;          // PS_CHANNEL
+            uint8_t  valid;            // PS_JOURNAL_VALID once complete
+} psJournalRecord;
+
+class PSJournal
+{
+    public:
+        PSJournal();
+        ~PSJournal();
+
+        /**
+         * @brief open Start journaling into a directory
+         * @param dir directory for the segment files (created if missing)
+         * @param segmentMB size of each pre-allocated segment
+         * @param keepSegments oldest segments beyond this count are removed, 0 keeps all
+         * @return True if the first segment could be created
+         */
+        bool    open(const string &dir, uint32_t segmentMB, uint32_t keepSegments);
+        void    close();
+        bool    isOpen() { return map != nullptr; }
+
+        // one record per channel, rotates to a new segment when full
+        bool    append(int64_t timeMs, const uint16_t raw[PS_CH_N]);
+
+        const string &segmentName() { return segPath; }
+
+    private:
+        bool    newSegment(int64_t timeMs);
+        void    closeSegment();
+        void    pruneSegments();
+
+        string   dir;
+        string   segPath;
+        size_t   segBytes { 0 };
+        uint32_t keep { 0 };
+
+        int      fd { -1 };
+        uint8_t *map { nullptr };
+        psJournalRecord *records { nullptr };
+        size_t   capacity { 0 };
+        size_t   next { 0 };
+        int64_t  baseTimeMs { 0 };
+};
+
+class PSJournalReader
+{
+    public:
+        PSJournalReader();
+        ~PSJournalReader();
+
+        bool    open(const char *path);
+        void    close();
+
+        // returns false at the end of the valid records
+        bool    next(int64_t *timeMs, uint8_t *channel, uint16_t *raw);
+
+    private:
+        int      fd { -1 };
+        uint8_t *map { nullptr };
+        size_t   mapSize { 0 };
+        const psJournalRecord *records { nullptr };
+        size_t   capacity { 0 };
+        size_t   pos { 0 };
+        int64_t  baseTimeMs { 0 };
+};
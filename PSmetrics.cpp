@@ -0,0 +1,274 @@
+/***************************************************************
+*  Program:      PSmetrics.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star Prometheus metrics exporter
+****************************************************************/
+
+#include "PSmetrics.h"
+#include "PSdiag.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+using namespace std;
+
+// value fields are right aligned in this many characters, enough for %.9g
+#define PS_METRIC_WIDTH     16
+
+// amps channel of each PSEnergy port
+static const uint8_t portAmps[PSEnergy::PS_E_N] = {
+    PS_CH_IN_AMPS, PS_CH_OUT1_AMPS, PS_CH_OUT2_AMPS, PS_CH_OUT3_AMPS, PS_CH_OUT4_AMPS,
+    PS_CH_VAR_AMPS, PS_CH_MP_AMPS, PS_CH_DEW1_AMPS, PS_CH_DEW2_AMPS
+};
+
+PSMetrics::PSMetrics()
+{
+    // lay the page out once, later updates only fill in the numbers
+    building = true;
+    render(nullptr);
+    building = false;
+    
+    // zeros until the first update
+    render(nullptr);
+}
+
+PSMetrics::~PSMetrics()
+{
+    close();
+}
+
+//******************************************************************
+void PSMetrics::family(const char *name, const char *type, const char *help)
+{
+    if (!building)
+        return;
+    buf += "# HELP ";
+    buf += name;
+    buf += ' ';
+    buf += help;
+    buf += "\n# TYPE ";
+    buf += name;
+    buf += ' ';
+    buf += type;
+    buf += '\n';
+}
+
+//******************************************************************
+void PSMetrics::put(const char *series, const char *label, double value)
+{
+    char field[PS_METRIC_WIDTH + 8];
+
+    if (building)
+    {
+        // series is a format with one %s for the label
+        char name[128];
+        snprintf(name, sizeof(name), series, label);
+        buf += name;
+        buf += ' ';
+        slots.push_back(buf.size());
+        buf.append(PS_METRIC_WIDTH, ' ');
+        buf += '\n';
+        return;
+    }
+
+    if (snprintf(field, sizeof(field), "%*.9g", PS_METRIC_WIDTH, value) > PS_METRIC_WIDTH)
+        snprintf(field, sizeof(field), "%*.3g", PS_METRIC_WIDTH, value);
+    memcpy(&buf[slots[next++]], field, PS_METRIC_WIDTH);
+}
+
+//******************************************************************
+// Walks every series in a fixed order: builds the page when building,
+// otherwise prints the sample's values into their fields
+void PSMetrics::render(const psMetricsSample *s)
+{
+    const float *v = s ? s->chanValue : nullptr;
+    const uint16_t *raw = s ? s->chanRaw : nullptr;
+    next = 0;
+
+    family("powerstar_up", "gauge", "1 while the driver is connected to the hub.");
+    put("powerstar_up", "", s && s->connected);
+
+    family("powerstar_volts", "gauge", "Port voltage.");
+    put("powerstar_volts{port=\"IN\"}", "", v ? v[PS_CH_IN_VOLTS] : 0);
+    put("powerstar_volts{port=\"Var\"}", "", v ? v[PS_CH_VAR_VOLTS] : 0);
+    put("powerstar_volts{port=\"Int\"}", "", v ? v[PS_CH_INT_VOLTS] : 0);
+
+    family("powerstar_amps", "gauge", "Port current.");
+    for (int i = 0; i < PSEnergy::PS_E_N; i++)
+        put("powerstar_amps{port=\"%s\"}", PSEnergy::portName[i], v ? v[portAmps[i]] : 0);
+
+    family("powerstar_amp_hours", "counter", "Charge delivered per port since the last reset.");
+    for (int i = 0; i < PSEnergy::PS_E_N; i++)
+        put("powerstar_amp_hours{port=\"%s\"}", PSEnergy::portName[i], s ? s->ampHrs[i] : 0);
+
+    family("powerstar_watt_hours", "counter", "Energy delivered per port since the last reset.");
+    for (int i = 0; i < PSEnergy::PS_E_N; i++)
+        put("powerstar_watt_hours{port=\"%s\"}", PSEnergy::portName[i], s ? s->wattHrs[i] : 0);
+
+    family("powerstar_dew_percent", "gauge", "Dew heater duty cycle.");
+    put("powerstar_dew_percent{port=\"Dew1\"}", "", v ? v[PS_CH_DEW1_PERCENT] : 0);
+    put("powerstar_dew_percent{port=\"Dew2\"}", "", v ? v[PS_CH_DEW2_PERCENT] : 0);
+
+    family("powerstar_temperature_celsius", "gauge", "Hub temperature sensor.");
+    put("powerstar_temperature_celsius", "", raw ? psTempC(raw[PS_CH_TEMP]) : 0);
+
+    family("powerstar_humidity_percent", "gauge", "Hub humidity sensor.");
+    put("powerstar_humidity_percent", "", v ? v[PS_CH_HUM] : 0);
+
+    family("powerstar_faults", "gauge", "Fault bits, fatal in the high 16 bits, non-fatal in the low 16.");
+    put("powerstar_faults", "", s ? s->faults : 0);
+
+    family("powerstar_focuser_position", "gauge", "Focuser position in steps.");
+    put("powerstar_focuser_position", "", s ? s->position : 0);
+
+    family("powerstar_tick_seconds", "gauge", "Duration of the last poll.");
+    put("powerstar_tick_seconds", "", s ? s->tickSec : 0);
+
+    family("powerstar_poll_period_seconds", "gauge", "Average time between poll starts.");
+    put("powerstar_poll_period_seconds", "", s ? s->periodSec : 0);
+
+    family("powerstar_poll_jitter_seconds", "gauge", "Average difference between the actual and planned poll period.");
+    put("powerstar_poll_jitter_seconds", "", s ? s->jitterSec : 0);
+
+    family("powerstar_ticks_total", "counter", "Polls since the driver started.");
+    put("powerstar_ticks_total", "", s ? s->ticks : 0);
+
+    // USB command health from PSdiag
+    psDiagSummary all;
+    if (s)
+        all = psDiag().total();
+    else
+        memset(&all, 0, sizeof(all));
+
+    family("powerstar_usb_commands_total", "counter", "USB commands sent.");
+    put("powerstar_usb_commands_total", "", all.calls);
+    family("powerstar_usb_timeouts_total", "counter", "USB commands with no reply.");
+    put("powerstar_usb_timeouts_total", "", all.timeouts);
+    family("powerstar_usb_retries_total", "counter", "Repeated USB device opens.");
+    put("powerstar_usb_retries_total", "", all.retries);
+    family("powerstar_usb_errors_total", "counter", "USB commands that failed (0xff).");
+    put("powerstar_usb_errors_total", "", all.errors);
+
+    family("powerstar_usb_latency_seconds", "summary", "USB command round trip percentiles.");
+    for (int i = 0; i < PS_DIAG_SHOWN; i++)
+    {
+        psDiagSummary d;
+        if (s)
+            d = psDiag().summary(psDiagShown[i]);
+        else
+            memset(&d, 0, sizeof(d));
+
+        const char *op = psOpcodeName(psDiagShown[i]);
+        put("powerstar_usb_latency_seconds{opcode=\"%s\",quantile=\"0.5\"}", op, d.p50 / 1e6);
+        put("powerstar_usb_latency_seconds{opcode=\"%s\",quantile=\"0.95\"}", op, d.p95 / 1e6);
+        put("powerstar_usb_latency_seconds{opcode=\"%s\",quantile=\"0.99\"}", op, d.p99 / 1e6);
+        put("powerstar_usb_latency_seconds{opcode=\"%s\",quantile=\"1\"}", op, d.max / 1e6);
+        put("powerstar_usb_latency_seconds_sum{opcode=\"%s\"}", op, d.sumUs / 1e6);
+        put("powerstar_usb_latency_seconds_count{opcode=\"%s\"}", op, d.calls);
+    }
+}
+
+//******************************************************************
+bool PSMetrics::openFile(const string &path)
+{
+    close();
+    filePath = path;
+    tmpPath = path + ".tmp";
+    return true;
+}
+
+//******************************************************************
+bool PSMetrics::openSocket(const string &path)
+{
+    struct sockaddr_un addr;
+
+    close();
+    if (path.size() >= sizeof(addr.sun_path))
+        return false;
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+        return false;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    // a stale socket from a previous run would make bind fail
+    unlink(path.c_str());
+    if (bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenFd, 4) < 0)
+    {
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    socketPath = path;
+    return true;
+}
+
+//******************************************************************
+void PSMetrics::close()
+{
+    if (listenFd >= 0)
+    {
+        ::close(listenFd);
+        unlink(socketPath.c_str());
+        listenFd = -1;
+    }
+    socketPath.clear();
+    filePath.clear();
+}
+
+//******************************************************************
+bool PSMetrics::update(const psMetricsSample &s)
+{
+    render(&s);
+
+    if (filePath.empty())
+        return true;
+
+    // the collector must never see a half written file
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    bool ok = ::write(fd, buf.data(), buf.size()) == ssize_t(buf.size());
+    ok = (::close(fd) == 0) && ok;
+    if (!ok || rename(tmpPath.c_str(), filePath.c_str()) < 0)
+    {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+//******************************************************************
+void PSMetrics::serve()
+{
+    char header[128];
+    char request[512];
+
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    // never let a stuck scraper hold up the driver
+    struct timeval tv = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // whatever was asked for, the answer is the page
+    recv(fd, request, sizeof(request), MSG_DONTWAIT);
+
+    int n = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                     "Content-Length: %zu\r\n\r\n", buf.size());
+    if (send(fd, header, n, MSG_NOSIGNAL) == n)
+        send(fd, buf.data(), buf.size(), MSG_NOSIGNAL);
+
+    ::close(fd);
+}
@@ -0,0 +1,76 @@
+/********************************************************
+*  Program:      PSmetrics.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star Prometheus metrics exporter
+*********************************************************/
+
+#pragma once
+
+#include "PSchannels.h"
+#include "PSenergy.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// one reading of everything exported
+typedef struct {
+            bool          connected;
+            const float  *chanValue;       // PSCTL::chanValue
+            const uint16_t *chanRaw;       // PSCTL::chanRaw
+            const double *ampHrs;          // PSEnergy::ampHrs
+            const double *wattHrs;         // PSEnergy::wattHrs
+            uint32_t      faults;          // checkFaults() bits
+            uint32_t      position;        // focuser ticks
+            double        tickSec;         // last TimerHit duration
+            double        periodSec;       // poll start to start (PSPoll)
+            double        jitterSec;
+            uint64_t      ticks;           // TimerHits since start
+} psMetricsSample;
+
+// Prometheus text exposition of the hub and driver health, written as
+// a node_exporter textfile (temp file then rename) or served on a Unix
+// socket (curl --unix-socket path http://localhost/metrics).
+//
+// The page is laid out once with a fixed width field for every value,
+// an update only prints the numbers into their fields.
+class PSMetrics
+{
+    public:
+        PSMetrics();
+        ~PSMetrics();
+
+        // path should end in .prom for the textfile collector
+        bool    openFile(const string &path);
+        bool    openSocket(const string &path);
+        void    close();
+        bool    isOpen() { return !filePath.empty() || listenFd >= 0; }
+
+        // listening socket for IEAddCallback, -1 in textfile mode
+        int     socketFd() { return listenFd; }
+
+        // refresh the values, then write the textfile if that is the mode
+        bool    update(const psMetricsSample &s);
+
+        // answer one scrape waiting on the socket
+        void    serve();
+
+        const string &page() { return buf; }
+
+    private:
+        void    render(const psMetricsSample *s);
+        void    family(const char *name, const char *type, const char *help);
+        void    put(const char *series, const char *label, double value);
+
+        string          buf;
+        vector<size_t>  slots;             // offset of each value field
+        bool            building { false };
+        size_t          next { 0 };
+
+        string          filePath;
+        string          tmpPath;
+        string          socketPath;
+        int             listenFd { -1 };
+};
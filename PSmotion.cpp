@@ -0,0 +1,129 @@
+/***************************************************************
+*  Program:      PSmotion.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star focuser move time model
+****************************************************************/
+
+#include "PSmotion.h"
+#include <algorithm>
+
+using namespace std;
+
+//******************************************************************
+void PSMotion::setProfile(float stepPeriodMs, uint16_t backlashSteps, uint8_t preferred)
+{
+    backlash = backlashSteps;
+    prefDir = preferred;
+
+    if (stepPeriodMs == profileStepMs)
+        return;
+
+    profileStepMs = stepPeriodMs;
+    stepMs = stepPeriodMs > 0 ? stepPeriodMs : 1;
+    learned = 0;
+}
+
+//******************************************************************
+uint32_t PSMotion::steps(uint32_t from, uint32_t to)
+{
+    if (from == to)
+        return 0;
+
+    // out is towards higher positions
+    bool out = to > from;
+    uint32_t dist = out ? to - from : from - to;
+
+    if (out != (prefDir == 1))
+        dist += 2 * backlash;
+    return dist;
+}
+
+//******************************************************************
+double PSMotion::predict(uint32_t from, uint32_t to)
+{
+    return steps(from, to) * stepMs;
+}
+
+//******************************************************************
+uint32_t PSMotion::positionAt(uint32_t from, uint32_t to, double ms)
+{
+    uint32_t total = steps(from, to);
+    double done = ms > 0 ? ms / stepMs : 0;
+    if (done >= total)
+        return to;
+
+    bool out = to > from;
+    uint32_t dist = out ? to - from : from - to;
+    uint32_t n = uint32_t(done);
+
+    // first leg, straight for the target or past it by the backlash
+    uint32_t leg1 = total > dist ? dist + backlash : dist;
+    if (n <= leg1)
+        return out ? from + n : (n > from ? 0 : from - n);
+
+    // coming back to the target from the far side
+    uint32_t back = total - n;
+    return out ? to + back : (back > to ? 0 : to - back);
+}
+
+//******************************************************************
+void PSMotion::observe(uint32_t from, uint32_t to, double ms)
+{
+    uint32_t n = steps(from, to);
+    if (n < PS_MOTION_MIN_STEPS || ms <= 0)
+        return;
+
+    double perStep = ms / n;
+    stepMs = learned == 0 ? perStep : stepMs + PS_MOTION_EWMA * (perStep - stepMs);
+    learned++;
+}
+
+//******************************************************************
+void PSMoveQueue::clear()
+{
+    legs.clear();
+    nextLeg = 0;
+    targets = 0;
+    reached = 0;
+}
+
+//******************************************************************
+bool PSMoveQueue::load(const vector<uint32_t> &list, uint32_t from, uint32_t overshoot,
+                       uint8_t prefDir, uint32_t maxPos)
+{
+    clear();
+    if (list.size() > PS_QUEUE_MAX)
+        return false;
+
+    legs.reserve(2 * list.size());
+    uint32_t at = from;
+    for (uint32_t to : list)
+    {
+        bool out = to > at;
+        if (overshoot > 0 && to != at && out != (prefDir == 1))
+        {
+            // past the target, so the last leg runs the preferred way
+            uint32_t past = out ? min(to + overshoot, maxPos) : (to > overshoot ? to - overshoot : 0);
+            if (past != to)
+                legs.push_back(Leg { past, false });
+        }
+        legs.push_back(Leg { to, true });
+        at = to;
+    }
+
+    targets = list.size();
+    return true;
+}
+
+//******************************************************************
+bool PSMoveQueue::pop(uint32_t *to, bool *arrival)
+{
+    if (!active())
+        return false;
+
+    *to = legs[nextLeg].to;
+    *arrival = legs[nextLeg].arrival;
+    nextLeg++;
+    return true;
+}
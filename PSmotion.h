@@ -0,0 +1,89 @@
+/********************************************************
+*  Program:      PSmotion.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star focuser move time model
+*********************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// moves shorter than this say more about USB latency than step time
+#define PS_MOTION_MIN_STEPS 50
+// weight of the newest move in the learned step time
+#define PS_MOTION_EWMA      0.3
+// targets one queued sweep may hold
+#define PS_QUEUE_MAX        256
+
+/**
+ * Predicts how long a focuser move takes from the profile: one step
+ * period per step, plus twice the backlash when the move ends against
+ * the preferred direction.  That assumes the hub goes past the target
+ * and comes back to it in the preferred direction; how the firmware
+ * takes up backlash isn't documented.  Finished moves refine the step
+ * time, which absorbs the hub's own per step overhead and whatever its
+ * backlash handling really costs.
+ */
+class PSMotion
+{
+    public:
+        // profile values, a new step period forgets what was learned
+        void    setProfile(float stepPeriodMs, uint16_t backlash, uint8_t prefDir);
+
+        // steps the motor makes going from -> to, backlash included
+        uint32_t steps(uint32_t from, uint32_t to);
+
+        // ms from the move command to the motor stopping
+        double  predict(uint32_t from, uint32_t to);
+
+        // where the motor should be ms into a move from -> to, following
+        // the backlash overshoot
+        uint32_t positionAt(uint32_t from, uint32_t to, double ms);
+
+        // a move from -> to took ms
+        void    observe(uint32_t from, uint32_t to, double ms);
+
+        double  stepMs { 1 };          // learned time per step
+        uint32_t learned { 0 };        // moves that went into stepMs
+
+    private:
+        float   profileStepMs { 0 };
+        uint16_t backlash { 0 };
+        uint8_t prefDir { 0 };         // 0: in, 1: out
+};
+
+/**
+ * A sweep of absolute targets run back to back.  With an overshoot, a
+ * target approached against the preferred direction gets an extra leg
+ * past it first, so every target is reached moving the preferred way.
+ */
+class PSMoveQueue
+{
+    public:
+        void    clear();
+
+        // false if there are too many targets
+        bool    load(const std::vector<uint32_t> &targets, uint32_t from, uint32_t overshoot,
+                     uint8_t prefDir, uint32_t maxPos);
+
+        bool    active() const { return nextLeg < legs.size(); }
+
+        // the next leg's position, arrival is true when it is a target
+        // rather than an overshoot
+        bool    pop(uint32_t *to, bool *arrival);
+
+        uint32_t targets { 0 };        // in the sweep
+        uint32_t reached { 0 };        // so far
+
+    private:
+        struct Leg
+        {
+            uint32_t to;
+            bool    arrival;
+        };
+        std::vector<Leg> legs;
+        size_t  nextLeg { 0 };
+};
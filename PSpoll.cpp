@@ -0,0 +1,81 @@
+/***************************************************************
+*  Program:      PSpoll.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star poll timing and adaptive period
+*
+*  Adaptive mode starts from the configured period and
+*   - drops to the minimum while the focuser moves
+*   - stretches so a tick never uses more than 1/PS_POLL_DUTY of
+*     the period (a slow or retrying USB link)
+*   - stretches by the host's load per CPU when that is over 1
+*  always within the configured minimum and maximum.
+****************************************************************/
+
+#include "PSpoll.h"
+
+using namespace std;
+
+static double msBetween(const struct timespec &a, const struct timespec &b)
+{
+    return (b.tv_sec - a.tv_sec) * 1000.0 + (b.tv_nsec - a.tv_nsec) / 1e6;
+}
+
+static double ewma(double avg, double v, bool first)
+{
+    return first ? v : avg + PS_POLL_EWMA * (v - avg);
+}
+
+//******************************************************************
+void PSPoll::begin(const struct timespec &mono)
+{
+    if (haveStart)
+    {
+        double period = msBetween(lastStart, mono);
+        bool first = periodMs == 0;
+        periodMs = ewma(periodMs, period, first);
+        jitterMs = ewma(jitterMs, period > targetMs ? period - targetMs : targetMs - period, first);
+    }
+
+    start = lastStart = mono;
+    haveStart = true;
+}
+
+//******************************************************************
+void PSPoll::end(const struct timespec &mono)
+{
+    elapsed = msBetween(start, mono);
+    tickMs = elapsed;
+    avgTickMs = ewma(avgTickMs, tickMs, avgTickMs == 0);
+    if (tickMs > targetMs)
+        overruns++;
+}
+
+//******************************************************************
+uint32_t PSPoll::next(bool moving, double load)
+{
+    double period = basePeriod;
+
+    if (adaptive)
+    {
+        if (moving)
+            period = minPeriod;
+        else
+        {
+            if (period < avgTickMs * PS_POLL_DUTY)
+                period = avgTickMs * PS_POLL_DUTY;
+            if (load > 1)
+                period *= load;
+        }
+
+        if (period < minPeriod)
+            period = minPeriod;
+        if (period > maxPeriod)
+            period = maxPeriod;
+    }
+
+    targetMs = period;
+
+    // the tick itself used part of the period
+    return elapsed >= period ? 1 : uint32_t(period - elapsed);
+}
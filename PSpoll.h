@@ -0,0 +1,57 @@
+/********************************************************
+*  Program:      PSpoll.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star poll timing and adaptive period
+*********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// keep the hub busy for at most 1/PS_POLL_DUTY of the time
+#define PS_POLL_DUTY        4
+// weight of the newest tick in the running averages
+#define PS_POLL_EWMA        0.2
+
+// Times each TimerHit and picks the delay to the next one, measured
+// start to start so the period no longer grows by the tick length.
+class PSPoll
+{
+    public:
+        // tick starting/finishing, CLOCK_MONOTONIC
+        void    begin(const struct timespec &mono);
+        void    end(const struct timespec &mono);
+
+        /**
+         * @brief next Choose the period and return the SetTimer delay
+         * @param moving focuser is moving, poll as fast as allowed
+         * @param load 1 minute load average per CPU, ignored if < 0
+         * @return ms from now to the next tick
+         */
+        uint32_t next(bool moving, double load);
+
+        // forget the last tick, e.g. across a disconnect
+        void    restart() { haveStart = false; }
+
+        // settings
+        bool    adaptive { false };
+        double  basePeriod { 500 };    // ms, the period in fixed mode
+        double  minPeriod { 250 };
+        double  maxPeriod { 5000 };
+
+        // measurements, ms
+        double  tickMs { 0 };          // last tick
+        double  avgTickMs { 0 };
+        double  periodMs { 0 };        // start to start, averaged
+        double  jitterMs { 0 };        // |actual - planned period|, averaged
+        double  targetMs { 500 };      // period in use
+        uint64_t overruns { 0 };       // ticks longer than the period
+
+    private:
+        bool    haveStart { false };
+        struct timespec start {};
+        struct timespec lastStart {};
+        double  elapsed { 0 };         // ms between begin and end
+};
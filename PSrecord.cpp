@@ -0,0 +1,255 @@
+/***************************************************************
+*  Program:      PSrecord.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star transport record/replay
+*
+*  The hub is one device per process, so every transport shares
+*  one recording (or one replay position), even the short lived
+*  PSCTL that Connect() makes.
+****************************************************************/
+
+#include "PSrecord.h"
+#include <string.h>
+#include <time.h>
+#include <thread>
+
+using namespace std;
+
+typedef chrono::steady_clock psClock;
+
+//******************************************************************
+// Recording shared by all PSRecordTransports
+static struct {
+    mutex      lock;
+    FILE      *fp { nullptr };
+    psClock::time_point start;
+    uint32_t   unflushed { 0 };
+} rec;
+
+static uint64_t sinceStart(psClock::time_point t)
+{
+    return chrono::duration_cast<chrono::microseconds>(t - rec.start).count();
+}
+
+static void logCall(PS_REC_OP op, psClock::time_point t0, int rc, const uint8_t *data, int len)
+{
+    psClock::time_point t1 = psClock::now();
+    psRecEntry e;
+    memset(&e, 0, sizeof(e));
+
+    lock_guard<mutex> l(rec.lock);
+    if (rec.fp == nullptr)
+        return;
+
+    e.tUs = sinceStart(t0);
+    e.durUs = chrono::duration_cast<chrono::microseconds>(t1 - t0).count();
+    e.op = op;
+    e.rc = rc;
+    if (data != nullptr && len > 0)
+    {
+        e.len = len > 3 ? 3 : len;
+        memcpy(e.data, data, e.len);
+    }
+    fwrite(&e, sizeof(e), 1, rec.fp);
+
+    // small batches, a crash only loses the last few calls
+    if (op == PS_REC_CLOSE || ++rec.unflushed >= 64)
+    {
+        fflush(rec.fp);
+        rec.unflushed = 0;
+    }
+}
+
+PSRecordTransport::PSRecordTransport(PSTransport *in, const char *path) : inner(in)
+{
+    lock_guard<mutex> l(rec.lock);
+    if (rec.fp != nullptr)
+        return;
+
+    rec.fp = fopen(path, "wbe");
+    if (rec.fp == nullptr)
+    {
+        fprintf(stderr, "PSrecord: unable to create %s\n", path);
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    psRecHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    strncpy(hdr.magic, PS_RECORD_MAGIC, sizeof(hdr.magic));
+    hdr.startUnixMs = int64_t(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+    fwrite(&hdr, sizeof(hdr), 1, rec.fp);
+
+    rec.start = psClock::now();
+}
+
+PSRecordTransport::~PSRecordTransport()
+{
+    delete inner;
+
+    lock_guard<mutex> l(rec.lock);
+    if (rec.fp != nullptr)
+        fflush(rec.fp);
+}
+
+//******************************************************************
+bool PSRecordTransport::open()
+{
+    psClock::time_point t0 = psClock::now();
+    bool ok = inner->open();
+    logCall(PS_REC_OPEN, t0, ok, nullptr, 0);
+    return ok;
+}
+
+//******************************************************************
+void PSRecordTransport::close()
+{
+    psClock::time_point t0 = psClock::now();
+    inner->close();
+    logCall(PS_REC_CLOSE, t0, 0, nullptr, 0);
+}
+
+//******************************************************************
+int PSRecordTransport::write(const uint8_t *cmd, int len)
+{
+    psClock::time_point t0 = psClock::now();
+    int rc = inner->write(cmd, len);
+    logCall(PS_REC_WRITE, t0, rc, cmd, len);
+    return rc;
+}
+
+//******************************************************************
+int PSRecordTransport::read(uint8_t *res, int len, int timeoutMs)
+{
+    psClock::time_point t0 = psClock::now();
+    int rc = inner->read(res, len, timeoutMs);
+    logCall(PS_REC_READ, t0, rc, res, rc > 0 ? rc : 0);
+    return rc;
+}
+
+/***************************************************************/
+/* Replay                                                      */
+/***************************************************************/
+static struct {
+    mutex      lock;
+    bool       loaded { false };
+    bool       started { false };
+    psClock::time_point start;          // replay time of the recording's start
+    vector<psRecEntry> entries;
+    size_t     next { 0 };
+    uint32_t   mismatches { 0 };
+} play;
+
+//******************************************************************
+// Next recorded call, false once the recording is used up
+static bool nextCall(PS_REC_OP op, psRecEntry *e, bool fast)
+{
+    {
+        lock_guard<mutex> l(play.lock);
+
+        // the driver may have gone down a different path, skip to the next call of this kind
+        while (play.next < play.entries.size() && play.entries[play.next].op != op)
+        {
+            play.next++;
+            play.mismatches++;
+        }
+        if (play.next >= play.entries.size())
+            return false;
+
+        *e = play.entries[play.next++];
+        
+        if (!play.started)
+        {
+            play.start = psClock::now() - chrono::microseconds(e->tUs);
+            play.started = true;
+        }
+    }
+
+    // the gap before the call as well as the call itself; a driver that is
+    // already behind the recording just goes on
+    if (!fast)
+    {
+        this_thread::sleep_until(play.start + chrono::microseconds(e->tUs));
+        this_thread::sleep_for(chrono::microseconds(e->durUs));
+    }
+
+    return true;
+}
+
+PSReplayTransport::PSReplayTransport(const char *path, bool fastReplay) : fast(fastReplay)
+{
+    lock_guard<mutex> l(play.lock);
+    if (play.loaded)
+        return;
+    play.loaded = true;
+
+    FILE *fp = fopen(path, "rbe");
+    psRecHeader hdr;
+    if (fp == nullptr || fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+            strncmp(hdr.magic, PS_RECORD_MAGIC, sizeof(hdr.magic)) != 0)
+    {
+        fprintf(stderr, "PSrecord: %s is not a transport recording\n", path);
+        if (fp != nullptr)
+            fclose(fp);
+        return;
+    }
+
+    psRecEntry e;
+    while (fread(&e, sizeof(e), 1, fp) == 1)
+        play.entries.push_back(e);
+    fclose(fp);
+}
+
+//******************************************************************
+bool PSReplayTransport::open()
+{
+    psRecEntry e;
+    opened = nextCall(PS_REC_OPEN, &e, fast) && e.rc;
+    return opened;
+}
+
+//******************************************************************
+void PSReplayTransport::close()
+{
+    psRecEntry e;
+    if (opened)
+        nextCall(PS_REC_CLOSE, &e, true);
+    opened = false;
+}
+
+//******************************************************************
+int PSReplayTransport::write(const uint8_t *cmd, int len)
+{
+    psRecEntry e;
+    if (!opened || !nextCall(PS_REC_WRITE, &e, fast))
+        return -1;
+
+    if (e.len != (len > 3 ? 3 : len) || memcmp(e.data, cmd, e.len) != 0)
+    {
+        lock_guard<mutex> l(play.lock);
+        play.mismatches++;
+    }
+    return e.rc;
+}
+
+//******************************************************************
+int PSReplayTransport::read(uint8_t *res, int len, int /*timeoutMs*/)
+{
+    psRecEntry e;
+    if (!opened || !nextCall(PS_REC_READ, &e, fast))
+        return -1;
+
+    if (e.rc > 0)
+        memcpy(res, e.data, e.len < len ? e.len : len);
+    return e.rc;
+}
+
+//******************************************************************
+uint32_t psReplayMismatches()
+{
+    lock_guard<mutex> l(play.lock);
+    return play.mismatches;
+}
@@ -0,0 +1,85 @@
+/********************************************************
+*  Program:      PSrecord.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star transport record/replay
+*********************************************************/
+
+#pragma once
+
+#include "PStransport.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// File layout (host byte order): psRecHeader then one psRecEntry per
+// transport call, in call order.
+#define PS_RECORD_MAGIC     "PSREC2"
+
+typedef struct {
+            char     magic[8];
+            int64_t  startUnixMs;      // wall clock when recording began
+            uint8_t  reserved[16];
+} psRecHeader;
+
+typedef enum { PS_REC_OPEN,
+               PS_REC_CLOSE,
+               PS_REC_WRITE,
+               PS_REC_READ
+} PS_REC_OP;
+
+typedef struct {
+            uint64_t tUs;              // call start, from the start of the recording
+            uint32_t durUs;            // how long the call took
+            uint8_t  op;               // PS_REC_OP
+            int8_t   rc;               // return value (open: 1/0)
+            uint8_t  len;              // bytes in data
+            uint8_t  data[3];          // command written or reply read
+            uint8_t  reserved[6];
+} psRecEntry;
+
+// Appends every call on a transport to a recording
+class PSRecordTransport : public PSTransport
+{
+    public:
+        PSRecordTransport(PSTransport *inner, const char *path);
+        ~PSRecordTransport();
+
+        bool open();
+        void close();
+        bool isOpen() { return inner->isOpen(); }
+        int  write(const uint8_t *cmd, int len);
+        int  read(uint8_t *res, int len, int timeoutMs);
+
+    private:
+        PSTransport *inner;
+};
+
+// Plays a recording back, in call order
+class PSReplayTransport : public PSTransport
+{
+    public:
+        /**
+         * @param path recording made by PSRecordTransport
+         * @param fast true: answer at once, false: make each call when the recorded
+         *        one was made (relative to the first) and take as long as it did
+         */
+        PSReplayTransport(const char *path, bool fast);
+
+        bool open();
+        void close();
+        bool isOpen() { return opened; }
+        int  write(const uint8_t *cmd, int len);
+        int  read(uint8_t *res, int len, int timeoutMs);
+
+    private:
+        bool opened { false };
+        bool fast;
+};
+
+// calls the driver made that the recording did not expect (0 = faithful replay)
+uint32_t psReplayMismatches();
@@ -0,0 +1,198 @@
+/***************************************************************
+*  Program:      PStempcomp.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star driver side temperature compensation
+****************************************************************/
+
+#include "PStempcomp.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <gsl/gsl_linalg.h>
+
+using namespace std;
+
+// mean |residual| to standard deviation for normal errors
+#define PS_TC_MAD_SIGMA     1.2533
+
+//******************************************************************
+void PSTempComp::clear()
+{
+    order = 0;
+    points = 0;
+    memset(coef, 0, sizeof(coef));
+    memset(sx, 0, sizeof(sx));
+    memset(sxy, 0, sizeof(sxy));
+    absRes = 0;
+    scale = PS_TC_MIN_SCALE;
+    anchored = false;
+}
+
+//******************************************************************
+void PSTempComp::add(double t, double pos)
+{
+    if (points == 0)
+    {
+        tRef = tMin = tMax = t;
+        scale = PS_TC_MIN_SCALE;
+    }
+
+    // Huber: full weight near the fit, k*scale/|r| beyond, so one bad
+    // autofocus run can't drag the model
+    double w = 1;
+    if (valid())
+    {
+        double r = fabs(pos - predict(t));
+        double limit = PS_TC_HUBER_K * scale;
+        if (r > limit)
+            w = limit / r;
+
+        // clipped too, or the outliers would widen the scale
+        absRes += PS_TC_SCALE_EWMA * (min(r, limit) - absRes);
+        scale = max(PS_TC_MIN_SCALE, PS_TC_MAD_SIGMA * absRes);
+    }
+
+    double x = t - tRef;
+    double xk = w;
+    for (int k = 0; k < 5; k++)
+    {
+        sx[k] += xk;
+        if (k < 3)
+            sxy[k] += xk * pos;
+        xk *= x;
+    }
+
+    points++;
+    tMin = min(tMin, t);
+    tMax = max(tMax, t);
+    solve();
+}
+
+//******************************************************************
+// Weighted normal equations, A c = b with A[i][j] = sum w x^(i+j)
+void PSTempComp::solve()
+{
+    double span = tMax - tMin;
+    int n = 0;
+    if (points >= PS_TC_QUAD_POINTS && span >= PS_TC_QUAD_SPAN)
+        n = 3;
+    else if (points >= 2 && span >= PS_TC_MIN_SPAN)
+        n = 2;
+
+    while (n >= 2)
+    {
+        double a[9], b[3], c[3];
+        size_t perm[3];
+        int sign;
+
+        for (int i = 0; i < n; i++)
+        {
+            b[i] = sxy[i];
+            for (int j = 0; j < n; j++)
+                a[i * n + j] = sx[i + j];
+        }
+
+        gsl_matrix_view A = gsl_matrix_view_array(a, n, n);
+        gsl_vector_view B = gsl_vector_view_array(b, n);
+        gsl_vector_view C = gsl_vector_view_array(c, n);
+        gsl_permutation p = { size_t(n), perm };
+
+        // a singular system would make GSL's error handler abort
+        gsl_linalg_LU_decomp(&A.matrix, &p, &sign);
+        if (fabs(gsl_linalg_LU_det(&A.matrix, sign)) > 1e-9 * pow(sx[0], n))
+        {
+            gsl_linalg_LU_solve(&A.matrix, &p, &B.vector, &C.vector);
+            memset(coef, 0, sizeof(coef));
+            memcpy(coef, c, n * sizeof(double));
+            order = n - 1;
+            return;
+        }
+        n--;
+    }
+    order = 0;
+}
+
+//******************************************************************
+double PSTempComp::predict(double t) const
+{
+    // a quadratic goes wild outside the temperatures it has seen,
+    // carry on along the slope at the edge instead
+    if (order == 2 && (t < tMin || t > tMax))
+    {
+        double edge = t < tMin ? tMin : tMax;
+        return predict(edge) + slope(edge) * (t - edge);
+    }
+
+    double x = t - tRef;
+    return coef[0] + coef[1] * x + coef[2] * x * x;
+}
+
+//******************************************************************
+double PSTempComp::slope(double t) const
+{
+    if (order == 2)
+        t = min(max(t, tMin), tMax);
+    return coef[1] + 2 * coef[2] * (t - tRef);
+}
+
+//******************************************************************
+void PSTempComp::anchor(double t, uint32_t pos)
+{
+    anchored = true;
+    anchorT = t;
+    anchorPos = pos;
+}
+
+//******************************************************************
+int32_t PSTempComp::correction(double t, uint32_t pos, double nowSec)
+{
+    if (!valid() || !anchored || nowSec - lastMoveSec < intervalSec)
+        return 0;
+
+    double d = anchorPos + predict(t) - predict(anchorT) - pos;
+    if (fabs(d) < hysteresis)
+        return 0;
+
+    if (fabs(d) > maxStep)
+        d = d > 0 ? maxStep : -maxStep;
+
+    lastMoveSec = nowSec;
+    return int32_t(lround(d));
+}
+
+//******************************************************************
+bool PSTempComp::load(const string &path)
+{
+    bool wasAnchored = anchored;
+    double t, pos;
+
+    clear();
+    anchored = wasAnchored;
+
+    FILE *fp = fopen(path.c_str(), "r");
+    if (!fp)
+        return false;
+
+    // same order as recorded, the Huber weights depend on it
+    while (fscanf(fp, "%lf %lf", &t, &pos) == 2)
+        add(t, pos);
+
+    fclose(fp);
+    return true;
+}
+
+//******************************************************************
+bool PSTempComp::save(const string &path, double t, double pos)
+{
+    string dir = path.substr(0, path.rfind('/'));
+    mkdir(dir.c_str(), 0755);
+
+    FILE *fp = fopen(path.c_str(), "a");
+    if (!fp)
+        return false;
+
+    bool ok = fprintf(fp, "%.2f %.0f\n", t, pos) > 0;
+    return (fclose(fp) == 0) && ok;
+}
@@ -0,0 +1,95 @@
+/********************************************************
+*  Program:      PStempcomp.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star driver side temperature compensation
+*********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+// Huber tuning constant, in robust standard deviations
+#define PS_TC_HUBER_K       1.345
+// weight of the newest residual in the robust scale
+#define PS_TC_SCALE_EWMA    0.2
+// residual scale never assumed below this many steps
+#define PS_TC_MIN_SCALE     5.0
+// a slope needs this temperature span (C) behind it
+#define PS_TC_MIN_SPAN      1.0
+// the quadratic term needs this many points over this span (C)
+#define PS_TC_QUAD_POINTS   8
+#define PS_TC_QUAD_SPAN     6.0
+
+/**
+ * Fits best focus position against temperature from recorded pairs and
+ * turns temperature changes into small focuser moves.
+ *
+ * The fit is weighted least squares kept as normal equation sums, so a
+ * new point costs O(1): its Huber weight comes from its residual to the
+ * current fit and a running robust scale, then the 2x2 or 3x3 system is
+ * solved again with GSL.  Linear until there are PS_TC_QUAD_POINTS over
+ * PS_TC_QUAD_SPAN, quadratic after.
+ *
+ * Moves are relative to an anchor, the position and temperature when the
+ * focuser last came to rest from a move the compensator did not make
+ * (autofocus, the user), so the model only supplies the change with
+ * temperature.
+ */
+class PSTempComp
+{
+    public:
+        // a best focus position found at temperature t (C)
+        void    add(double t, double pos);
+        void    clear();
+
+        // points kept in a text file, one "t pos" pair per line
+        bool    load(const std::string &path);
+        bool    save(const std::string &path, double t, double pos);
+
+        bool    valid() const { return order > 0; }
+        // fitted position at t, and its slope (steps/C)
+        double  predict(double t) const;
+        double  slope(double t) const;
+
+        // start compensating from here
+        void    anchor(double t, uint32_t pos);
+        void    unanchor() { anchored = false; }
+        bool    isAnchored() const { return anchored; }
+        double  anchorTemp() const { return anchored ? anchorT : 0; }
+
+        /**
+         * @brief correction Steps to move now, 0 for none
+         * @param t temperature (C)
+         * @param pos current position
+         * @param nowSec monotonic seconds, for the rate limit
+         */
+        int32_t correction(double t, uint32_t pos, double nowSec);
+
+        // settings
+        double  hysteresis { 10 };     // steps, smaller corrections wait
+        double  maxStep { 50 };        // steps per move
+        double  intervalSec { 60 };    // between moves
+
+        // fit
+        int     order { 0 };           // 0: no model, 1: linear, 2: quadratic
+        uint32_t points { 0 };
+        double  coef[3] {};            // in (t - tRef)
+        double  scale { 0 };           // robust residual scale, steps
+
+    private:
+        void    solve();
+
+        double  tRef { 0 };            // first point's temperature
+        double  tMin { 0 };
+        double  tMax { 0 };
+        double  sx[5] {};              // sum w x^k, k 0..4
+        double  sxy[3] {};             // sum w x^k y, k 0..2
+        double  absRes { 0 };          // running mean |residual|
+
+        bool    anchored { false };
+        double  anchorT { 0 };
+        double  anchorPos { 0 };
+        double  lastMoveSec { -1e9 };
+};
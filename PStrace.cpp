@@ -0,0 +1,223 @@
+/***************************************************************
+*  Program:      PStrace.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star span tracing (Chrome trace JSON)
+*
+*  Each thread writes its spans into its own ring, the only shared
+*  step is claiming a ring the first time a thread traces.  A dump
+*  copies the rings while they are being written, seqlock fashion, and
+*  drops any span whose slot may have been rewritten during the copy.
+****************************************************************/
+
+#include "PStrace.h"
+#include <stdio.h>
+
+#ifdef POWERSTAR_TRACE
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+typedef struct {
+            const char *name;
+            uint64_t    startUs;
+            uint32_t    durUs;
+            char        arg[PS_TRACE_ARG_LEN];
+} psTraceEvent;
+
+typedef struct {
+            uint32_t              tid;
+            uint32_t              mask;
+            bool                  inUse;
+            atomic<uint64_t>      head;          // events ever written
+            psTraceEvent         *events;
+} psTraceRing;
+
+// rings outlive their threads (a burst worker's spans are still wanted
+// after it exits), a new thread takes over a free ring
+static mutex ringLock;
+static vector<psTraceRing *> rings;
+
+//******************************************************************
+static uint64_t nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+//******************************************************************
+static psTraceRing *claimRing()
+{
+    lock_guard<mutex> l(ringLock);
+
+    for (psTraceRing *r : rings)
+    {
+        if (!r->inUse)
+        {
+            r->inUse = true;
+            r->tid = syscall(SYS_gettid);
+            return r;
+        }
+    }
+
+    uint32_t size = PS_TRACE_EVENTS_DEFAULT;
+    const char *env = getenv("PS_TRACE_EVENTS");
+    if (env != nullptr && atoi(env) > 0)
+    {
+        // round up to a power of two
+        size = 1;
+        while (size < uint32_t(atoi(env)) && size < (1u << 26))
+            size <<= 1;
+    }
+
+    psTraceRing *r = new psTraceRing;
+    r->tid = syscall(SYS_gettid);
+    r->mask = size - 1;
+    r->inUse = true;
+    r->head.store(0, memory_order_relaxed);
+    r->events = new psTraceEvent[size];
+    rings.push_back(r);
+    return r;
+}
+
+// hands the ring back when its thread exits
+class PSTraceOwner
+{
+    public:
+        psTraceRing *ring { nullptr };
+        ~PSTraceOwner()
+        {
+            if (ring == nullptr)
+                return;
+            lock_guard<mutex> l(ringLock);
+            ring->inUse = false;
+        }
+};
+
+static thread_local PSTraceOwner owner;
+
+//******************************************************************
+static void emit(const char *name, const char *arg, uint64_t startUs, uint64_t endUs)
+{
+    if (owner.ring == nullptr)
+        owner.ring = claimRing();
+
+    psTraceRing *r = owner.ring;
+    uint64_t h = r->head.load(memory_order_relaxed);
+    psTraceEvent &e = r->events[h & r->mask];
+
+    // a dump that sees any of this write also sees head at h, and so
+    // knows slot h - size is being overwritten
+    atomic_thread_fence(memory_order_release);
+
+    e.name = name;
+    e.startUs = startUs;
+    e.durUs = uint32_t(endUs - startUs);
+    if (arg != nullptr)
+        strncpy(e.arg, arg, PS_TRACE_ARG_LEN - 1);
+    e.arg[arg != nullptr ? PS_TRACE_ARG_LEN - 1 : 0] = 0;
+
+    r->head.store(h + 1, memory_order_release);
+}
+
+PSTraceSpan::PSTraceSpan(const char *spanName, const char *spanArg) : name(spanName), arg(spanArg), startUs(nowUs())
+{
+}
+
+PSTraceSpan::~PSTraceSpan()
+{
+    emit(name, arg, startUs, nowUs());
+}
+
+//******************************************************************
+void PSTraceSpan::next(const char *nextName)
+{
+    uint64_t t = nowUs();
+    emit(name, arg, startUs, t);
+    name = nextName;
+    arg = nullptr;
+    startUs = t;
+}
+
+//******************************************************************
+bool psTraceEnabled()
+{
+    return true;
+}
+
+//******************************************************************
+static void writeEvent(FILE *fp, const psTraceEvent &e, uint32_t tid, bool *first)
+{
+    char arg[PS_TRACE_ARG_LEN];
+    size_t n = 0;
+
+    // property names only, but keep the JSON valid whatever turns up
+    for (const char *a = e.arg; *a && n < sizeof(arg) - 1; a++)
+        arg[n++] = (*a == '"' || *a == '\\' || (unsigned char)*a < 0x20) ? '_' : *a;
+    arg[n] = 0;
+
+    fprintf(fp, "%s\n{\"name\":\"%s%s%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%u,\"pid\":1,\"tid\":%u}",
+            *first ? "" : ",", e.name, n ? " " : "", arg,
+            (unsigned long long)e.startUs, e.durUs, tid);
+    *first = false;
+}
+
+//******************************************************************
+bool psTraceDump(const char *path)
+{
+    FILE *fp = fopen(path, "we");
+    if (fp == nullptr)
+        return false;
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+
+    lock_guard<mutex> l(ringLock);
+    for (psTraceRing *r : rings)
+    {
+        uint64_t size = uint64_t(r->mask) + 1;
+        uint64_t head = r->head.load(memory_order_acquire);
+        // slot head - size is the one the owner writes next
+        uint64_t from = head >= size ? head - size + 1 : 0;
+
+        for (uint64_t i = from; i < head; i++)
+        {
+            psTraceEvent e = r->events[i & r->mask];
+            atomic_thread_fence(memory_order_acquire);
+            // event i + size goes in this slot, once head reaches that
+            // the owner may have been writing it while we copied
+            if (r->head.load(memory_order_relaxed) - i >= size)
+                continue;
+            writeEvent(fp, e, r->tid, &first);
+        }
+    }
+
+    fprintf(fp, "\n]}\n");
+    return fclose(fp) == 0;
+}
+
+#else
+
+//******************************************************************
+bool psTraceEnabled()
+{
+    return false;
+}
+
+//******************************************************************
+bool psTraceDump(const char *path)
+{
+    (void)path;
+    return false;
+}
+
+#endif
@@ -0,0 +1,67 @@
+/********************************************************
+*  Program:      PStrace.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star span tracing (Chrome trace JSON)
+*********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+// Build with -DPOWERSTAR_TRACE (cmake -DPOWERSTAR_TRACE=ON) to record
+// spans.  Without it the macros below expand to nothing.
+//
+//   PS_TRACE_SPAN("name")              span until the end of the scope
+//   PS_TRACE_SPAN_ARG("name", text)    same, text (e.g. a property name) is copied
+//   PS_TRACE_PHASE(var, "name")        named span that PS_TRACE_NEXT(var, "next")
+//                                      ends and follows with the next phase
+//
+// Names must be string literals (only the pointer is kept).
+
+#ifdef POWERSTAR_TRACE
+
+#define PS_TRACE_CAT2(a, b)             a##b
+#define PS_TRACE_CAT(a, b)              PS_TRACE_CAT2(a, b)
+#define PS_TRACE_SPAN(name)             PSTraceSpan PS_TRACE_CAT(psTraceSpan, __LINE__)(name)
+#define PS_TRACE_SPAN_ARG(name, arg)    PSTraceSpan PS_TRACE_CAT(psTraceSpan, __LINE__)(name, arg)
+#define PS_TRACE_PHASE(var, name)       PSTraceSpan var(name)
+#define PS_TRACE_NEXT(var, name)        var.next(name)
+
+// events kept per thread unless PS_TRACE_EVENTS says otherwise (40 bytes each)
+#define PS_TRACE_EVENTS_DEFAULT         (1 << 18)
+#define PS_TRACE_ARG_LEN                20
+
+class PSTraceSpan
+{
+    public:
+        explicit PSTraceSpan(const char *name, const char *arg = nullptr);
+        ~PSTraceSpan();
+
+        // end this span and start another in its place
+        void    next(const char *name);
+
+    private:
+        const char *name;
+        const char *arg;
+        uint64_t    startUs;
+};
+
+#else
+
+#define PS_TRACE_SPAN(name)
+#define PS_TRACE_SPAN_ARG(name, arg)
+#define PS_TRACE_PHASE(var, name)
+#define PS_TRACE_NEXT(var, name)
+
+#endif
+
+// true when the build records spans
+bool psTraceEnabled();
+
+/**
+ * @brief psTraceDump Write every thread's recorded spans as Chrome trace
+ *        JSON (chrome://tracing or ui.perfetto.dev).  Recording carries on.
+ * @return False if tracing is not built in or the file can't be written
+ */
+bool psTraceDump(const char *path);
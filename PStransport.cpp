@@ -0,0 +1,78 @@
+/***************************************************************
+*  Program:      PStransport.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star command transport
+****************************************************************/
+
+#include "PStransport.h"
+#include "PSemulator.h"
+#include "PSrecord.h"
+#include "hidapi.h"
+#include <stdlib.h>
+
+using namespace std;
+
+// The hub itself
+class PSHidTransport : public PSTransport
+{
+    public:
+        ~PSHidTransport() { close(); }
+
+        bool open()
+        {
+            handle = hid_open(PS_VID, PS_PID, nullptr);
+            if (handle == nullptr)
+                hid_exit();
+            return handle != nullptr;
+        }
+
+        void close()
+        {
+            if (handle == nullptr)
+                return;
+            hid_close(handle);
+            hid_exit();
+            handle = nullptr;
+        }
+
+        bool isOpen() { return handle != nullptr; }
+
+        int write(const uint8_t *cmd, int len)
+        {
+            return hid_write(handle, cmd, len);
+        }
+
+        int read(uint8_t *res, int len, int timeoutMs)
+        {
+            return hid_read_timeout(handle, res, len, timeoutMs);
+        }
+
+    private:
+        hid_device *handle { nullptr };
+};
+
+//******************************************************************
+PSTransport *psCreateTransport()
+{
+    const char *replay = getenv("PS_REPLAY");
+    const char *emulate = getenv("PS_EMULATE");
+    const char *record = getenv("PS_RECORD");
+    PSTransport *transport;
+
+    if (replay != nullptr)
+        return new PSReplayTransport(replay, getenv("PS_REPLAY_FAST") != nullptr);
+
+    if (emulate != nullptr)
+    {
+        psEmulator().configure(emulate);
+        transport = new PSEmuTransport(psEmulator());
+    }
+    else
+        transport = new PSHidTransport();
+
+    if (record != nullptr)
+        transport = new PSRecordTransport(transport, record);
+
+    return transport;
+}
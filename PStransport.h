@@ -0,0 +1,41 @@
+/********************************************************
+*  Program:      PStransport.h
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star command transport
+*********************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+// Power*Star USB ids
+#define PS_VID  0x04D8
+#define PS_PID  0xEC42
+
+// How PSCTL reaches the hub.  A session is open() .. close(), each
+// command is one write() of up to 3 bytes followed by one read() of
+// the 3 byte reply, same as hidapi.  PSCTL keeps one session open
+// across commands, closing it after a failed command and on Disconnect.
+class PSTransport
+{
+    public:
+        virtual ~PSTransport() {}
+
+        virtual bool open() = 0;
+        virtual void close() = 0;
+        virtual bool isOpen() = 0;
+
+        // return bytes written/read, -1 on error, read returns 0 on timeout
+        virtual int  write(const uint8_t *cmd, int len) = 0;
+        virtual int  read(uint8_t *res, int len, int timeoutMs) = 0;
+};
+
+/**
+ * @brief psCreateTransport Transport selected by the environment
+ *        PS_REPLAY=file: play back a recording (PS_REPLAY_FAST set: without the recorded delays)
+ *        PS_EMULATE set: the in-process emulator (see PSemulator.h)
+ *        otherwise: the Power*Star over hidapi
+ *        PS_RECORD=file additionally records every call (see PSrecord.h)
+ */
+PSTransport *psCreateTransport();
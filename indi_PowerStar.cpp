@@ -7,7 +7,19 @@ Requires:       PScontrol.cpp hidapi.c
 ***************************************************************************/
 
 #include "indi_PowerStar.h"
+#include "PStrace.h"
 #include "config.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef POWERSTAR_TRACE
+// trace every property flush, inside its own macro the name is the real function
+#define IDSetNumber(p, ...) do { PS_TRACE_SPAN_ARG("IDSetNumber", (p)->name); IDSetNumber(p, __VA_ARGS__); } while (0)
+#define IDSetSwitch(p, ...) do { PS_TRACE_SPAN_ARG("IDSetSwitch", (p)->name); IDSetSwitch(p, __VA_ARGS__); } while (0)
+#define IDSetText(p, ...)   do { PS_TRACE_SPAN_ARG("IDSetText", (p)->name); IDSetText(p, __VA_ARGS__); } while (0)
+#define IDSetLight(p, ...)  do { PS_TRACE_SPAN_ARG("IDSetLight", (p)->name); IDSetLight(p, __VA_ARGS__); } while (0)
+#define IDSetBLOB(p, ...)   do { PS_TRACE_SPAN_ARG("IDSetBLOB", (p)->name); IDSetBLOB(p, __VA_ARGS__); } while (0)
+#endif
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -58,6 +70,9 @@ PSpower::PSpower() : FI(this), WI(this)
     FI::SetCapability(FOCUSER_CAN_ABS_MOVE | FOCUSER_CAN_REL_MOVE | FOCUSER_CAN_ABORT | FOCUSER_CAN_SYNC);
     //setSupportedConnections(CONNECTION_NONE);
     setVersion(PS_VERSION_MAJOR, PS_VERSION_MINOR);
+    
+    // history query results are bounded, so allocate the buffer once
+    historyBuf.resize(PSHistory::maxQuerySize());
 }
 
 const char *PSpower::getDefaultName()
@@ -68,18 +83,16 @@ const char *PSpower::getDefaultName()
 /***************************************************************/
 bool PSpower::Connect()
 {   
-    PSCTL psctl;
-    
+    // the session opened here is kept for everything after
     if ( ! psctl.Connect() )  //this does the unlock as well
     {
         LOG_ERROR("No Power*Star found.");
         return false;
     }
     
-    AmpHrs = WattHrs = 0;
-    
-    psctl.getMaxPosition(&maximumPosition);
-    psctl.getAbsPosition(&relitivePosition);
+    readHub();
+    maximumPosition = curProfile.maxPosition;
+    relitivePosition = curProfile.curPosition;
 
     FocusMaxPosN[0].value = maximumPosition;
     FocusAbsPosN[0].max = FocusSyncN[0].max = FocusMaxPosN[0].value;
@@ -92,16 +105,115 @@ bool PSpower::Connect()
     
 	LOG_INFO("Power*Star connected successfully.");
 
-    POLLMS = 500;
+    POLLMS = PollSetN[POLL_PERIOD].value;
+    poll.restart();
     
     SetTimer(POLLMS);
     
 	return true;
 }
 
+/***************************************************************/
+// Everything the properties start from, each register read once: the
+// status, the profile (with the focuser positions) and the firmware
+void PSpower::readHub()
+{
+    PS_TRACE_SPAN("readHub");
+    
+    // ask P*S for it's current power/dew/usb settings
+    psctl.getStatus();
+    // and it's current focus settings
+    curProfile = psctl.getProfileStatus(true);
+    uint16_t psversion = psctl.getVersion();
+    
+    char fversion[8];
+    snprintf(fversion, sizeof(fversion), "%i.%i", (psversion & 0xFF00) >> 8, psversion & 0xFF);
+    IUSaveText(&FirmwareT[FIRMWARE_VERSION], fversion);
+    
+    if (curProfile.profType > 4)
+        curProfile.profType = 4;
+    
+    IUResetSwitch(&TemplateSP);
+    TemplateS[curProfile.profType].s = ISS_ON;
+    IUResetSwitch(&MtrTypeSP);
+    MtrTypeS[curProfile.motorType ? Bipolar : Unipolar].s = ISS_ON;
+    IUResetSwitch(&PrefDirSP);
+    PrefDirS[curProfile.prefDir ? Out : In].s = ISS_ON;
+    IUResetSwitch(&RevMtrSP);
+    RevMtrS[curProfile.reverseMtr ? Yes : No].s = ISS_ON;
+    IUResetSwitch(&TempCompSP);
+    if (curProfile.tempSensor < TempComp_N)
+        TempCompS[curProfile.tempSensor].s = ISS_ON;
+    IUResetSwitch(&MotorBrkSP);
+    if (curProfile.motorBraking < MotorBrk_N)
+        MotorBrkS[curProfile.motorBraking].s = ISS_ON;
+    IUResetSwitch(&PermFocSP);
+    PermFocS[curProfile.disablePermFocus ? Yes : No].s = ISS_ON;
+    
+    MtrProfN[Backlash].value = curProfile.backlash;
+    MtrProfN[IdleCur].value = curProfile.idleMtrCurrent;
+    MtrProfN[StepPer].value = curProfile.stepPeriod;
+    MtrProfN[TempCoef].value = curProfile.tempCoef;
+    MtrProfN[DrvCur].value = curProfile.driveMtrCurrent;
+    MtrProfN[TempHys].value = curProfile.tempHysterisis;
+    
+    AutoBootS[ABOUT1].s = psctl.statusMap["Out1"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABOUT2].s = psctl.statusMap["Out2"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABOUT3].s = psctl.statusMap["Out3"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABOUT4].s = psctl.statusMap["Out4"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABVAR].s = psctl.statusMap["Var"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABMP].s = psctl.statusMap["MP"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABDEWA].s = psctl.statusMap["Dew1"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABDEWB].s = psctl.statusMap["Dew2"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABUSB2].s = psctl.statusMap["USB2"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABUSB3].s = psctl.statusMap["USB3"].autoboot ? ISS_ON : ISS_OFF;
+    AutoBootS[ABUSB6].s = psctl.statusMap["USB6"].autoboot ? ISS_ON : ISS_OFF;
+    
+    PortCtlS[OUT1].s = psctl.statusMap["Out1"].state ? ISS_ON : ISS_OFF;
+    PortCtlS[OUT2].s = psctl.statusMap["Out2"].state ? ISS_ON : ISS_OFF;
+    PortCtlS[OUT3].s = psctl.statusMap["Out3"].state ? ISS_ON : ISS_OFF;
+    PortCtlS[OUT4].s = psctl.statusMap["Out4"].state ? ISS_ON : ISS_OFF;
+    PortCtlS[VAR].s = psctl.statusMap["Var"].state ? ISS_ON : ISS_OFF;
+    PortCtlS[MP].s = psctl.statusMap["MP"].state ? ISS_ON : ISS_OFF;
+    
+    USBpwS[PUSB2].s = psctl.statusMap["USB2"].state ? ISS_ON : ISS_OFF;
+    USBpwS[PUSB3].s = psctl.statusMap["USB3"].state ? ISS_ON : ISS_OFF;
+    USBpwS[PUSB6].s = psctl.statusMap["USB6"].state ? ISS_ON : ISS_OFF;
+    USBlightsL[PUSB2].s = psctl.statusMap["USB2"].state ? IPS_OK : IPS_ALERT;
+    USBlightsL[PUSB3].s = psctl.statusMap["USB3"].state ? IPS_OK : IPS_ALERT;
+    USBlightsL[PUSB6].s = psctl.statusMap["USB6"].state ? IPS_OK : IPS_ALERT;
+    
+    DEWpwS[DEW1].s = psctl.statusMap["Dew1"].state ? ISS_ON : ISS_OFF;
+    DEWpwS[DEW2].s = psctl.statusMap["Dew2"].state ? ISS_ON : ISS_OFF;
+    DEWpwS[MPdew].s = psctl.statusMap["MP"].state ? ISS_ON : ISS_OFF;
+}
+
 /***************************************************************/
 bool PSpower::Disconnect()
 {
+    if (journal.isOpen()) {
+        journal.close();
+        IUResetSwitch(&JournalSP);
+        JournalS[JOURNAL_OFF].s = ISS_ON;
+    }
+    
+    if (burst.isActive())
+        finishBurst();
+    
+    energy.restart();
+    saveConfig(true, EnergyNP.name);
+    
+    if (exporter.isOpen()) {
+        exporter.close();
+        IUResetSwitch(&ExportSP);
+        ExportS[EXPORT_OFF].s = ISS_ON;
+    }
+    
+    // the exporter keeps running, scrapers see powerstar_up 0
+    publishMetrics(false);
+    
+    stopTracking();
+    
     psctl.Disconnect();
 	LOG_INFO("Power*Star disconnected successfully.");
 	return true;
@@ -119,10 +231,8 @@ bool PSpower::initProperties()
     FI::initProperties(FOCUS_TAB);
     addAuxControls();
     
-    // ask P*S for it's current power/dew/usb settings
-    psctl.getStatus();
-    // ask P*S for it's current focus settings (and fault mask)
-    curProfile = psctl.getProfileStatus();
+    // no USB here, the hub isn't connected yet: the switches and values
+    // that show its state are filled in by readHub() on connect
     //TODO someplace we need to read the saved fault mask and set it in the profile 
     
     /***************/
@@ -164,10 +274,7 @@ bool PSpower::initProperties()
     /* INFO Tab    */
     /***************/
     // PowerStar Firmware
-    uint16_t psversion = psctl.getVersion();
-    char fversion[5];
-    snprintf(fversion, 4, "%i.%i", (psversion & 0xFF00) >> 8, psversion & 0xFF);
-    IUFillText(&FirmwareT[FIRMWARE_VERSION], "FIRMWARE", "Firmware", fversion);
+    IUFillText(&FirmwareT[FIRMWARE_VERSION], "FIRMWARE", "Firmware", "");
     IUFillTextVector(&FirmwareTP, FirmwareT, 1, getDeviceName(), "VERSION_INFO", "Power*Star", INFO_TAB, IP_RO, 60, IPS_IDLE);
     
     /***************/
@@ -181,74 +288,71 @@ bool PSpower::initProperties()
     // Template (optional)
     
     // ALERT not showing which profile on startup and does not autosave
-    if (curProfile.profType > 4)
-        curProfile.profType = 4;
-    
-    IUFillSwitch(&TemplateS[HSM], "THSM", "HSM", (curProfile.profType == 0) ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&TemplateS[PDMS], "TPDMS", "PDMS", (curProfile.profType == 1) ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&TemplateS[UNI12], "TUNI12", "UNI12", (curProfile.profType == 2) ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&TemplateS[CUST], "TCUST", "CUST", (curProfile.profType == 3) ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&TemplateS[NOTSET], "TNOTSET", "NOT-SET", (curProfile.profType == 4) ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&TemplateS[HSM], "THSM", "HSM", ISS_OFF);
+    IUFillSwitch(&TemplateS[PDMS], "TPDMS", "PDMS", ISS_OFF);
+    IUFillSwitch(&TemplateS[UNI12], "TUNI12", "UNI12", ISS_OFF);
+    IUFillSwitch(&TemplateS[CUST], "TCUST", "CUST", ISS_OFF);
+    IUFillSwitch(&TemplateS[NOTSET], "TNOTSET", "NOT-SET", ISS_OFF);
     IUFillSwitchVector(&TemplateSP, TemplateS, Template_N, getDeviceName(), "TEMPLATE", "Template (Optional)", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
     
     //Motor Type
-    IUFillSwitch(&MtrTypeS[Unipolar], "UNIPOLAR", "Unipolar", curProfile.motorType ? ISS_OFF : ISS_ON);
-    IUFillSwitch(&MtrTypeS[Bipolar], "BIPOLAR", "Bipolar", curProfile.motorType ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&MtrTypeS[Unipolar], "UNIPOLAR", "Unipolar", ISS_OFF);
+    IUFillSwitch(&MtrTypeS[Bipolar], "BIPOLAR", "Bipolar", ISS_OFF);
     IUFillSwitchVector(&MtrTypeSP, MtrTypeS, MtrType_N, getDeviceName(), "MOTORTYPE", "Type", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
     
     //Prefered Direction
-    IUFillSwitch(&PrefDirS[In], "DIN", "In", curProfile.prefDir ? ISS_OFF : ISS_ON);
-    IUFillSwitch(&PrefDirS[Out], "DOUT", "Out", curProfile.prefDir ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&PrefDirS[In], "DIN", "In", ISS_OFF);
+    IUFillSwitch(&PrefDirS[Out], "DOUT", "Out", ISS_OFF);
     IUFillSwitchVector(&PrefDirSP, PrefDirS, PrefDir_N, getDeviceName(), "PREFDIR", "Pref Dir", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
     
     //Reverse Motor
-    IUFillSwitch(&RevMtrS[Yes], "RYES", "Yes", curProfile.reverseMtr ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&RevMtrS[No], "RNO", "No", curProfile.reverseMtr ? ISS_OFF : ISS_ON);
+    IUFillSwitch(&RevMtrS[Yes], "RYES", "Yes", ISS_OFF);
+    IUFillSwitch(&RevMtrS[No], "RNO", "No", ISS_OFF);
     IUFillSwitchVector(&RevMtrSP, RevMtrS, RevMtr_N, getDeviceName(), "REVMTR", "Rev Mtr", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
     
     //Temperature Compensation 
-    IUFillSwitch(&TempCompS[None], "TNONE", "None", (curProfile.tempSensor == 0) ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&TempCompS[Motor], "TMOTOR", "Motor", (curProfile.tempSensor == 1) ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&TempCompS[Env], "TENV", "ENV", (curProfile.tempSensor == 2) ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&TempCompS[None], "TNONE", "None", ISS_OFF);
+    IUFillSwitch(&TempCompS[Motor], "TMOTOR", "Motor", ISS_OFF);
+    IUFillSwitch(&TempCompS[Env], "TENV", "ENV", ISS_OFF);
     IUFillSwitchVector(&TempCompSP, TempCompS, TempComp_N, getDeviceName(), "TEMPCOMP", "Temp Comp", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
 
     // Motor breaking when locked
-    IUFillSwitch(&MotorBrkS[MCnone], "MCNONE", "None", (curProfile.motorBraking == 0) ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&MotorBrkS[MClow], "MCLOW", "Low", (curProfile.motorBraking == 1) ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&MotorBrkS[MCidle], "MCIDLE", "Idle", (curProfile.motorBraking == 2) ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&MotorBrkS[MCnone], "MCNONE", "None", ISS_OFF);
+    IUFillSwitch(&MotorBrkS[MClow], "MCLOW", "Low", ISS_OFF);
+    IUFillSwitch(&MotorBrkS[MCidle], "MCIDLE", "Idle", ISS_OFF);
     IUFillSwitchVector(&MotorBrkSP, MotorBrkS, MotorBrk_N, getDeviceName(), "MTRBRKNG", "Lck Mtr Braking", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
     
     // Motor Params
-    IUFillNumber(&MtrProfN[Backlash], "TBACK", "Backlash", "%3.0f", 0, 255, 5, curProfile.backlash);
-    IUFillNumber(&MtrProfN[IdleCur], "TIDLE", "Idle Current", "%5.0f", 0, 254, 5, curProfile.idleMtrCurrent);
-    IUFillNumber(&MtrProfN[StepPer], "TSTEP", "Step Period", "%3.1f", 0, 10, 1, curProfile.stepPeriod);
-    IUFillNumber(&MtrProfN[TempCoef], "TCOEF", "Temp Coef", "%5.0f", 0, 255, 5, curProfile.tempCoef);
-    IUFillNumber(&MtrProfN[DrvCur], "TDRV", "Drive Current", "%5.1f", 0, 255, 5, curProfile.driveMtrCurrent);
-    IUFillNumber(&MtrProfN[TempHys], "THSY", "Hysteresis", "%5.0f", 0, 25.5, 1, curProfile.tempHysterisis);
+    IUFillNumber(&MtrProfN[Backlash], "TBACK", "Backlash", "%3.0f", 0, 255, 5, 0);
+    IUFillNumber(&MtrProfN[IdleCur], "TIDLE", "Idle Current", "%5.0f", 0, 254, 5, 0);
+    IUFillNumber(&MtrProfN[StepPer], "TSTEP", "Step Period", "%3.1f", 0, 10, 1, 0);
+    IUFillNumber(&MtrProfN[TempCoef], "TCOEF", "Temp Coef", "%5.0f", 0, 255, 5, 0);
+    IUFillNumber(&MtrProfN[DrvCur], "TDRV", "Drive Current", "%5.1f", 0, 255, 5, 0);
+    IUFillNumber(&MtrProfN[TempHys], "THSY", "Hysteresis", "%5.0f", 0, 25.5, 1, 0);
     IUFillNumberVector(&MtrProfNP, MtrProfN, MtrProf_N, getDeviceName(), "MTRPROF", "Profile", OPTIONS_TAB, IP_RW, 0, IPS_IDLE);
     
     //Disable Perm Focus 
-    IUFillSwitch(&PermFocS[Yes], "PYES", "Yes", curProfile.disablePermFocus ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&PermFocS[No], "PNO", "No", curProfile.disablePermFocus ? ISS_OFF : ISS_ON);
+    IUFillSwitch(&PermFocS[Yes], "PYES", "Yes", ISS_OFF);
+    IUFillSwitch(&PermFocS[No], "PNO", "No", ISS_OFF);
     IUFillSwitchVector(&PermFocSP, PermFocS, RevMtr_N, getDeviceName(), "PERMFOC", "Perm Focus", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
     
     /***********************/
     /* Rest of Options tab */
     /***********************/
     //Autoboot
-    IUFillSwitch(&AutoBootS[ABOUT1], "AB_PORT1", "Port1", psctl.statusMap["Out1"].autoboot ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&AutoBootS[ABOUT2], "AB_PORT2", "Port2", psctl.statusMap["Out2"].autoboot ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&AutoBootS[ABOUT3], "AB_PORT3", "Port3", psctl.statusMap["Out3"].autoboot ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&AutoBootS[ABOUT4], "AB_PORT4", "Port4", psctl.statusMap["Out4"].autoboot ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABOUT1], "AB_PORT1", "Port1", ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABOUT2], "AB_PORT2", "Port2", ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABOUT3], "AB_PORT3", "Port3", ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABOUT4], "AB_PORT4", "Port4", ISS_OFF);
     //TODO must save Var value
-    IUFillSwitch(&AutoBootS[ABVAR], "AB_VAR", "Variable", psctl.statusMap["Var"].autoboot ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABVAR], "AB_VAR", "Variable", ISS_OFF);
     //TODO must save MP type and settings
-    IUFillSwitch(&AutoBootS[ABMP], "AB_MP", "MultiPurpose", psctl.statusMap["MP"].autoboot ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&AutoBootS[ABDEWA], "AB_DEWA", "DewA", psctl.statusMap["Dew1"].autoboot ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&AutoBootS[ABDEWB], "AB_DEWB", "DewB", psctl.statusMap["Dew2"].autoboot ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&AutoBootS[ABUSB2], "AB_USB2", "Usb2", psctl.statusMap["USB2"].autoboot ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&AutoBootS[ABUSB3], "AB_USB3", "Usb3", psctl.statusMap["USB3"].autoboot ? ISS_ON : ISS_OFF);
-    IUFillSwitch(&AutoBootS[ABUSB6], "AB_USB6", "Usb6", psctl.statusMap["USB6"].autoboot ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABMP], "AB_MP", "MultiPurpose", ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABDEWA], "AB_DEWA", "DewA", ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABDEWB], "AB_DEWB", "DewB", ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABUSB2], "AB_USB2", "Usb2", ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABUSB3], "AB_USB3", "Usb3", ISS_OFF);
+    IUFillSwitch(&AutoBootS[ABUSB6], "AB_USB6", "Usb6", ISS_OFF);
     IUFillSwitchVector(&AutoBootSP, AutoBootS, AutoBoot_N, getDeviceName(), "AUTOBOOT_ENABLES", "Autoboot", OPTIONS_TAB, IP_RW, ISR_NOFMANY, 60, IPS_IDLE);
     
     // Profile devices
@@ -312,42 +416,42 @@ bool PSpower::initProperties()
     // Port 1
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), PortLabelsTP.name, PortLabelsT[OUT1].name, portLabel, MAXINDILABEL);
-    IUFillSwitch(&PortCtlS[OUT1], "CPORT1", portRC == -1 ? "Port 1" : portLabel, psctl.statusMap["Out1"].state ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&PortCtlS[OUT1], "CPORT1", portRC == -1 ? "Port 1" : portLabel, ISS_OFF);
     IUFillLight(&PORTlightsL[OUT1], "LPORT1", portRC == -1 ? "Port 1" : portLabel, IPS_OK);
     IUFillNumber(&PortCurrentN[OUT1], "CURRENT_OUT1", portRC == -1 ? "Port 1" : portLabel, "%0.2f", 0, 0, 0, 0);
     
     // Port 2
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), PortLabelsTP.name, PortLabelsT[OUT2].name, portLabel, MAXINDILABEL);
-    IUFillSwitch(&PortCtlS[OUT2], "CPORT2", portRC == -1 ? "Port 2" : portLabel, psctl.statusMap["Out2"].state ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&PortCtlS[OUT2], "CPORT2", portRC == -1 ? "Port 2" : portLabel, ISS_OFF);
     IUFillLight(&PORTlightsL[OUT2], "LPORT2", portRC == -1 ? "Port 2" : portLabel, IPS_OK);
     IUFillNumber(&PortCurrentN[OUT2], "CURRENT_OUT2", portRC == -1 ? "Port 2" : portLabel, "%0.2f", 0, 0, 0, 0);
     
     // Port 3
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), PortLabelsTP.name, PortLabelsT[OUT3].name, portLabel, MAXINDILABEL);
-    IUFillSwitch(&PortCtlS[OUT3], "CPORT3", portRC == -1 ? "Port 3" : portLabel, psctl.statusMap["Out3"].state ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&PortCtlS[OUT3], "CPORT3", portRC == -1 ? "Port 3" : portLabel, ISS_OFF);
     IUFillLight(&PORTlightsL[OUT3], "LPORT3", portRC == -1 ? "Port 3" : portLabel, IPS_OK);
     IUFillNumber(&PortCurrentN[OUT3], "CURRENT_OUT3", portRC == -1 ? "Port 3" : portLabel, "%0.2f", 0, 0, 0, 0);
     
     // Port 4
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), PortLabelsTP.name, PortLabelsT[OUT4].name, portLabel, MAXINDILABEL);
-    IUFillSwitch(&PortCtlS[OUT4], "CPORT4", portRC == -1 ? "Port 4" : portLabel, psctl.statusMap["Out4"].state ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&PortCtlS[OUT4], "CPORT4", portRC == -1 ? "Port 4" : portLabel, ISS_OFF);
     IUFillLight(&PORTlightsL[OUT4], "LPORT4", portRC == -1 ? "Port 4" : portLabel, IPS_OK);
     IUFillNumber(&PortCurrentN[OUT4], "CURRENT_OUT4", portRC == -1 ? "Port 4" : portLabel, "%0.2f", 0, 0, 0, 0);
     
     // Var Port
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), PortLabelsTP.name, PortLabelsT[VAR].name, portLabel, MAXINDILABEL);
-    IUFillSwitch(&PortCtlS[VAR], "CVAR", portRC == -1 ? "Variable" : portLabel, psctl.statusMap["Var"].state ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&PortCtlS[VAR], "CVAR", portRC == -1 ? "Variable" : portLabel, ISS_OFF);
     IUFillLight(&PORTlightsL[VAR], "LVAR", portRC == -1 ? "Variable" : portLabel, IPS_OK);
     IUFillNumber(&PortCurrentN[VAR], "CURRENT_VAR", portRC == -1 ? "Variable" : portLabel, "%0.2f", 0, 0, 0, 0);
     
     // MP Port
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), PortLabelsTP.name, PortLabelsT[MP].name, portLabel, MAXINDILABEL);
-    IUFillSwitch(&PortCtlS[MP], "CMP", portRC == -1 ? "MultiPurpose" : portLabel, psctl.statusMap["MP"].state ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&PortCtlS[MP], "CMP", portRC == -1 ? "MultiPurpose" : portLabel, ISS_OFF);
     IUFillLight(&PORTlightsL[MP], "LMP", portRC == -1 ? "MultiPurpose" : portLabel, IPS_OK);
     IUFillNumber(&PortCurrentN[MP], "CURRENT_MP", portRC == -1 ? "MultiPurpose" : portLabel, "%0.2f", 0, 0, 0, 0);
     
@@ -356,6 +460,18 @@ bool PSpower::initProperties()
     IUFillSwitchVector(&PortCtlSP, PortCtlS, POWER_N, getDeviceName(), "PORT_ENABLES", "Enable", POWER_TAB, IP_RW, ISR_NOFMANY, 60, IPS_IDLE);
     IUFillNumberVector(&PortCurrentNP, PortCurrentN, POWER_N, getDeviceName(), "PORT_CURRENT", "Current", POWER_TAB, IP_RO, 0, IPS_IDLE);
     
+    // Energy per port since the last Clear
+    for (int p = 0; p < PSEnergy::PS_E_N; p++) {
+        char ename[MAXINDINAME], elabel[MAXINDILABEL];
+        snprintf(ename, sizeof(ename), "ENERGY_%s_AH", PSEnergy::portName[p]);
+        snprintf(elabel, sizeof(elabel), "%s Ah", PSEnergy::portName[p]);
+        IUFillNumber(&EnergyN[p * 2], ename, elabel, "%0.3f", 0, 1e6, 0, 0);
+        snprintf(ename, sizeof(ename), "ENERGY_%s_WH", PSEnergy::portName[p]);
+        snprintf(elabel, sizeof(elabel), "%s Wh", PSEnergy::portName[p]);
+        IUFillNumber(&EnergyN[p * 2 + 1], ename, elabel, "%0.2f", 0, 1e6, 0, 0);
+    }
+    IUFillNumberVector(&EnergyNP, EnergyN, PSEnergy::PS_E_N * 2, getDeviceName(), "ENERGY", "Energy", POWER_TAB, IP_RO, 0, IPS_IDLE);
+    
     // All On
     IUFillSwitch(&AllS[ALLON], "ALL_ON", "All On", ISS_OFF);
     IUFillSwitch(&AllS[ALLOFF], "ALL_OFF", "All Off", ISS_OFF);
@@ -377,20 +493,20 @@ bool PSpower::initProperties()
     // USB 2 
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), USBLabelsTP.name, USBLabelsT[USB2].name, portLabel, MAXINDILABEL);
-    IUFillSwitch(&USBpwS[PUSB2], "PSUSB2", portRC == -1 ? "USB 2" : portLabel, psctl.statusMap["USB2"].state ? ISS_ON : ISS_OFF);
-    IUFillLight(&USBlightsL[PUSB2], "LUSB2", portRC == -1 ? "USB 2" : portLabel, psctl.statusMap["USB2"].state ? IPS_OK : IPS_ALERT);
+    IUFillSwitch(&USBpwS[PUSB2], "PSUSB2", portRC == -1 ? "USB 2" : portLabel, ISS_OFF);
+    IUFillLight(&USBlightsL[PUSB2], "LUSB2", portRC == -1 ? "USB 2" : portLabel, IPS_IDLE);
     
     // USB 3
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), USBLabelsTP.name, USBLabelsT[USB3].name, portLabel, MAXINDILABEL);
-    IUFillSwitch(&USBpwS[PUSB3], "PSUSB3", portRC == -1 ? "USB 3" : portLabel, psctl.statusMap["USB3"].state ? ISS_ON : ISS_OFF);
-    IUFillLight(&USBlightsL[PUSB3], "LUSB3", portRC == -1 ? "USB 3" : portLabel, psctl.statusMap["USB3"].state ? IPS_OK : IPS_ALERT);
+    IUFillSwitch(&USBpwS[PUSB3], "PSUSB3", portRC == -1 ? "USB 3" : portLabel, ISS_OFF);
+    IUFillLight(&USBlightsL[PUSB3], "LUSB3", portRC == -1 ? "USB 3" : portLabel, IPS_IDLE);
     
     // USB 6
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), USBLabelsTP.name, USBLabelsT[USB6].name, portLabel, MAXINDILABEL);
-    IUFillSwitch(&USBpwS[PUSB6], "PSUSB6", portRC == -1 ? "USB 6" : portLabel, psctl.statusMap["USB6"].state ? ISS_ON : ISS_OFF);
-    IUFillLight(&USBlightsL[PUSB6], "LUSB6", portRC == -1 ? "USB 6" : portLabel, psctl.statusMap["USB6"].state ? IPS_OK : IPS_ALERT);
+    IUFillSwitch(&USBpwS[PUSB6], "PSUSB6", portRC == -1 ? "USB 6" : portLabel, ISS_OFF);
+    IUFillLight(&USBlightsL[PUSB6], "LUSB6", portRC == -1 ? "USB 6" : portLabel, IPS_IDLE);
     
     IUFillSwitchVector(&USBpwSP, USBpwS, USBPW_N, getDeviceName(), "USB_ENABLES", "Power", USB_TAB, IP_RW, ISR_NOFMANY, 60, IPS_IDLE);
     IUFillLightVector(&USBlightsLP, USBlightsL, USBPW_N, getDeviceName(), "USB_PORT_LIGHTS", "Status", USB_TAB, IPS_IDLE);
@@ -415,7 +531,7 @@ bool PSpower::initProperties()
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), DewLabelsTP.name, DewLabelsT[DEW1].name, portLabel, MAXINDILABEL);
     IUFillNumber(&DEWpercentN[DEW1], "DEW1", portRC == -1 ? "Dew 1" : portLabel, "%.0f", 0, 100, 1, 0);
-    IUFillSwitch(&DEWpwS[DEW1], "DW1", portRC == -1 ? "Dew 1" : portLabel, psctl.statusMap["Dew1"].state ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&DEWpwS[DEW1], "DW1", portRC == -1 ? "Dew 1" : portLabel, ISS_OFF);
     IUFillSwitch(&AutoDewS[DEW1], "ADW1", "DEW 1", ISS_OFF);
     IUFillLight(&DEWlightsL[DEW1], "LDEW1", portRC == -1 ? "Dew 1" : portLabel, IPS_OK);
     IUFillNumber(&DewCurrentN[DEW1], "CDEW1", portRC == -1 ? "Dew 1" : portLabel, "%.2f", 0, 100, 1, 0);
@@ -424,7 +540,7 @@ bool PSpower::initProperties()
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), DewLabelsTP.name, DewLabelsT[DEW2].name, portLabel, MAXINDILABEL);
     IUFillNumber(&DEWpercentN[DEW2], "DEW2", portRC == -1 ? "Dew 2" : portLabel, "%.0f", 0, 100, 1, 0);
-    IUFillSwitch(&DEWpwS[DEW2], "DW2", portRC == -1 ? "Dew 2" : portLabel, psctl.statusMap["Dew2"].state ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&DEWpwS[DEW2], "DW2", portRC == -1 ? "Dew 2" : portLabel, ISS_OFF);
     IUFillSwitch(&AutoDewS[DEW2], "ADW2", "DEW 2", ISS_OFF);
     IUFillLight(&DEWlightsL[DEW2], "LDEW2", portRC == -1 ? "Dew 2" : portLabel, IPS_OK);
     IUFillNumber(&DewCurrentN[DEW2], "CDEW2", portRC == -1 ? "Dew 2" : portLabel, "%.2f", 0, 100, 1, 0);
@@ -433,7 +549,7 @@ bool PSpower::initProperties()
     memset(portLabel, 0, MAXINDILABEL);
     portRC = IUGetConfigText(getDeviceName(), DewLabelsTP.name, DewLabelsT[MPdew].name, portLabel, MAXINDILABEL);
     IUFillNumber(&DEWpercentN[MPdew], "MPdew", "MP DEW", "%.0f", 0, 100, 1, 0);
-    IUFillSwitch(&DEWpwS[MPdew], "DMP", "MP DEW", psctl.statusMap["MP"].state ? ISS_ON : ISS_OFF);
+    IUFillSwitch(&DEWpwS[MPdew], "DMP", "MP DEW", ISS_OFF);
     IUFillSwitch(&AutoDewS[MPdew], "ADMP", "MP DEW", ISS_OFF);
     IUFillLight(&DEWlightsL[MPdew], "LPdew", "MP Dew", IPS_OK);
     IUFillNumber(&DewCurrentN[MPdew], "CDdew", "MP Dew", "%.2f", 0, 100, 1, 0);
@@ -536,6 +652,12 @@ bool PSpower::initProperties()
     addParameter("WEATHER_DEW_POINT", "Dew Point (F)", 0, 90, 5);
     addParameter("WEATHER_DP_DEP", "DP Depresion", -100, -1, 1);
     
+    // addParameter reallocates ParametersNP, look them up after the last one
+    weatherParam[WP_TEMP] = IUFindNumber(&ParametersNP, "WEATHER_TEMPERATURE");
+    weatherParam[WP_HUM] = IUFindNumber(&ParametersNP, "WEATHER_HUMIDITY");
+    weatherParam[WP_DEWPT] = IUFindNumber(&ParametersNP, "WEATHER_DEW_POINT");
+    weatherParam[WP_DPDEP] = IUFindNumber(&ParametersNP, "WEATHER_DP_DEP");
+    
     setCriticalParameter("WEATHER_TEMPERATURE");
     setCriticalParameter("WEATHER_HUMIDITY");
     setCriticalParameter("WEATHER_DP_DEP");
@@ -552,6 +674,195 @@ bool PSpower::initProperties()
     IUFillNumber(&NoneDisplayN[LEDbrightness], "NDledbrit", "LedBrit", "%.2f", 3, 10, 0.1, 0);
     IUFillNumberVector(&NoneDisplayNP, NoneDisplayN, NoneDisplay_N, getDeviceName(), "NONDISP", "None Display", USRLIMIT_TAB, IP_RO, 60, IPS_IDLE);
     
+    /*****************/
+    /* Telemetry tab */
+    /*****************/
+    // History query: channel name, from/to (unix seconds, <= 0 is relative to now), resolution (1s, 1m, 10m or auto)
+    IUFillText(&HistoryQueryT[HIST_CHANNEL], "HIST_CHANNEL", "Channel", psChannels[PS_CH_IN_AMPS].name);
+    IUFillText(&HistoryQueryT[HIST_FROM], "HIST_FROM", "From", "-3600");
+    IUFillText(&HistoryQueryT[HIST_TO], "HIST_TO", "To", "0");
+    IUFillText(&HistoryQueryT[HIST_RES], "HIST_RES", "Resolution", "auto");
+    IUFillTextVector(&HistoryQueryTP, HistoryQueryT, HistQuery_N, getDeviceName(), "HISTORY_QUERY", "History Query", TELEMETRY_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillBLOB(&HistoryB[0], "HISTORY_CSV", "History", ".csv");
+    IUFillBLOBVector(&HistoryBP, HistoryB, 1, getDeviceName(), "HISTORY_DATA", "History", TELEMETRY_TAB, IP_RO, 60, IPS_IDLE);
+    
+    // Journal of every raw sample (decode with pstelemetry)
+    IUFillSwitch(&JournalS[JOURNAL_ON], "JOURNAL_ON", "On", ISS_OFF);
+    IUFillSwitch(&JournalS[JOURNAL_OFF], "JOURNAL_OFF", "Off", ISS_ON);
+    IUFillSwitchVector(&JournalSP, JournalS, Journal_N, getDeviceName(), "JOURNAL", "Journal", TELEMETRY_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    
+    string journalDir = string(getenv("HOME") ? getenv("HOME") : "/tmp") + "/.indi/powerstar";
+    IUFillText(&JournalDirT[0], "JOURNAL_DIR", "Directory", journalDir.c_str());
+    IUFillTextVector(&JournalDirTP, JournalDirT, 1, getDeviceName(), "JOURNAL_DIR", "Journal Dir", TELEMETRY_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillNumber(&JournalSetN[JOURNAL_SEGMENT_MB], "JOURNAL_SEGMENT_MB", "Segment (MB)", "%.0f", 1, 256, 1, 8);
+    IUFillNumber(&JournalSetN[JOURNAL_KEEP], "JOURNAL_KEEP", "Keep Segments", "%.0f", 0, 1000, 1, 30);
+    IUFillNumberVector(&JournalSetNP, JournalSetN, JournalSet_N, getDeviceName(), "JOURNAL_SETTINGS", "Journal", TELEMETRY_TAB, IP_RW, 60, IPS_IDLE);
+    
+    // Compressed columnar export into the journal directory
+    IUFillSwitch(&ExportS[EXPORT_ON], "EXPORT_ON", "On", ISS_OFF);
+    IUFillSwitch(&ExportS[EXPORT_OFF], "EXPORT_OFF", "Off", ISS_ON);
+    IUFillSwitchVector(&ExportSP, ExportS, Export_N, getDeviceName(), "EXPORT", "Export", TELEMETRY_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    
+    // Burst capture of one volts/amps channel at the hub's full rate
+    for (int i = 0; i < PS_BURST_CHANNELS; i++)
+        IUFillSwitch(&BurstChanS[i], psChannels[psBurstChannels[i]].name, psChannels[psBurstChannels[i]].name, i == 1 ? ISS_ON : ISS_OFF);
+    IUFillSwitchVector(&BurstChanSP, BurstChanS, PS_BURST_CHANNELS, getDeviceName(), "BURST_CHANNEL", "Burst Channel", TELEMETRY_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    
+    IUFillNumber(&BurstSetN[BURST_SECONDS], "BURST_SECONDS", "Duration (s)", "%.1f", 0.1, PS_BURST_MAX_SEC, 0.5, 2);
+    IUFillNumber(&BurstSetN[BURST_THRESHOLD], "BURST_THRESHOLD", "Threshold", "%.2f", 0, 100, 0.5, 5);
+    IUFillNumberVector(&BurstSetNP, BurstSetN, BurstSet_N, getDeviceName(), "BURST_SETTINGS", "Burst", TELEMETRY_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillSwitch(&BurstS[0], "BURST_START", "Capture", ISS_OFF);
+    IUFillSwitchVector(&BurstSP, BurstS, 1, getDeviceName(), "BURST", "Burst", TELEMETRY_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+    
+    IUFillNumber(&BurstStatsN[BURST_PEAK], "BURST_PEAK", "Peak", "%.3f", 0, 1000, 0, 0);
+    IUFillNumber(&BurstStatsN[BURST_RMS], "BURST_RMS", "RMS", "%.3f", 0, 1000, 0, 0);
+    IUFillNumber(&BurstStatsN[BURST_OVER], "BURST_OVER", "Over Threshold (s)", "%.4f", 0, PS_BURST_MAX_SEC, 0, 0);
+    IUFillNumber(&BurstStatsN[BURST_SAMPLES], "BURST_SAMPLES", "Samples", "%.0f", 0, PS_BURST_MAX, 0, 0);
+    IUFillNumber(&BurstStatsN[BURST_RATE], "BURST_RATE", "Rate (Hz)", "%.1f", 0, 10000, 0, 0);
+    IUFillNumberVector(&BurstStatsNP, BurstStatsN, BurstStats_N, getDeviceName(), "BURST_STATS", "Burst Result", TELEMETRY_TAB, IP_RO, 60, IPS_IDLE);
+    
+    IUFillBLOB(&BurstB[0], "BURST_CSV", "Burst", ".csv");
+    IUFillBLOBVector(&BurstBP, BurstB, 1, getDeviceName(), "BURST_DATA", "Burst", TELEMETRY_TAB, IP_RO, 60, IPS_IDLE);
+    
+    // Prometheus metrics, a node_exporter textfile or a Unix socket
+    IUFillSwitch(&MetricsS[METRICS_OFF], "METRICS_OFF", "Off", ISS_ON);
+    IUFillSwitch(&MetricsS[METRICS_FILE], "METRICS_FILE", "Textfile", ISS_OFF);
+    IUFillSwitch(&MetricsS[METRICS_SOCKET], "METRICS_SOCKET", "Socket", ISS_OFF);
+    IUFillSwitchVector(&MetricsSP, MetricsS, Metrics_N, getDeviceName(), "METRICS", "Metrics", TELEMETRY_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    
+    IUFillText(&MetricsPathT[METRICS_FILE_PATH], "METRICS_FILE_PATH", "Textfile", (journalDir + "/powerstar.prom").c_str());
+    IUFillText(&MetricsPathT[METRICS_SOCKET_PATH], "METRICS_SOCKET_PATH", "Socket", "/tmp/powerstar-metrics.sock");
+    IUFillTextVector(&MetricsPathTP, MetricsPathT, MetricsPath_N, getDeviceName(), "METRICS_PATH", "Metrics", TELEMETRY_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillNumber(&MetricsPeriodN[0], "METRICS_PERIOD", "Period (s)", "%.0f", 1, 300, 1, 15);
+    IUFillNumberVector(&MetricsPeriodNP, MetricsPeriodN, 1, getDeviceName(), "METRICS_PERIOD", "Metrics", TELEMETRY_TAB, IP_RW, 60, IPS_IDLE);
+    
+    /*******************/
+    /* Diagnostics tab */
+    /*******************/
+    // USB command round trips, latencies in ms
+    IUFillNumber(&DiagCountsN[DIAG_CALLS], "DIAG_CALLS", "Commands", "%.0f", 0, 1e12, 0, 0);
+    IUFillNumber(&DiagCountsN[DIAG_TIMEOUTS], "DIAG_TIMEOUTS", "Timeouts", "%.0f", 0, 1e12, 0, 0);
+    IUFillNumber(&DiagCountsN[DIAG_RETRIES], "DIAG_RETRIES", "Open Retries", "%.0f", 0, 1e12, 0, 0);
+    IUFillNumber(&DiagCountsN[DIAG_ERRORS], "DIAG_ERRORS", "0xff Errors", "%.0f", 0, 1e12, 0, 0);
+    IUFillNumber(&DiagCountsN[DIAG_P50], "DIAG_P50", "p50 (ms)", "%.2f", 0, 60000, 0, 0);
+    IUFillNumber(&DiagCountsN[DIAG_P95], "DIAG_P95", "p95 (ms)", "%.2f", 0, 60000, 0, 0);
+    IUFillNumber(&DiagCountsN[DIAG_P99], "DIAG_P99", "p99 (ms)", "%.2f", 0, 60000, 0, 0);
+    IUFillNumber(&DiagCountsN[DIAG_MAX], "DIAG_MAX", "Max (ms)", "%.2f", 0, 60000, 0, 0);
+    IUFillNumberVector(&DiagCountsNP, DiagCountsN, DiagCounts_N, getDeviceName(), "DIAG_COUNTS", "All Commands", DIAG_TAB, IP_RO, 60, IPS_IDLE);
+    
+    for (int i = 0; i < PS_DIAG_SHOWN; i++)
+    {
+        char label[32];
+        snprintf(label, sizeof(label), "0x%02x %s", psDiagShown[i], psOpcodeName(psDiagShown[i]));
+        IUFillText(&DiagLatencyT[i], psOpcodeName(psDiagShown[i]), label, "");
+        
+        // size the text once, publishDiag prints into it in place
+        char blank[DIAG_LINE];
+        memset(blank, ' ', sizeof(blank) - 1);
+        blank[sizeof(blank) - 1] = 0;
+        IUSaveText(&DiagLatencyT[i], blank);
+        DiagLatencyT[i].text[0] = 0;
+    }
+    IUFillTextVector(&DiagLatencyTP, DiagLatencyT, PS_DIAG_SHOWN, getDeviceName(), "DIAG_LATENCY", "Per Command", DIAG_TAB, IP_RO, 60, IPS_IDLE);
+    
+    // poll timing, ms
+    IUFillNumber(&PollStatsN[POLL_TICK], "POLL_TICK", "Tick (ms)", "%.1f", 0, 60000, 0, 0);
+    IUFillNumber(&PollStatsN[POLL_TICK_AVG], "POLL_TICK_AVG", "Avg Tick (ms)", "%.1f", 0, 60000, 0, 0);
+    IUFillNumber(&PollStatsN[POLL_ACTUAL], "POLL_ACTUAL", "Period (ms)", "%.1f", 0, 60000, 0, 0);
+    IUFillNumber(&PollStatsN[POLL_JITTER], "POLL_JITTER", "Jitter (ms)", "%.1f", 0, 60000, 0, 0);
+    IUFillNumber(&PollStatsN[POLL_TARGET], "POLL_TARGET", "Target (ms)", "%.0f", 0, 60000, 0, 0);
+    IUFillNumber(&PollStatsN[POLL_OVERRUNS], "POLL_OVERRUNS", "Overruns", "%.0f", 0, 1e12, 0, 0);
+    IUFillNumberVector(&PollStatsNP, PollStatsN, PollStats_N, getDeviceName(), "POLL_STATS", "Polling", DIAG_TAB, IP_RO, 60, IPS_IDLE);
+    
+    IUFillSwitch(&PollModeS[POLL_FIXED], "POLL_FIXED", "Fixed", ISS_ON);
+    IUFillSwitch(&PollModeS[POLL_ADAPTIVE], "POLL_ADAPTIVE", "Adaptive", ISS_OFF);
+    IUFillSwitchVector(&PollModeSP, PollModeS, PollMode_N, getDeviceName(), "POLL_MODE", "Poll Mode", DIAG_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    
+    IUFillNumber(&PollSetN[POLL_PERIOD], "POLL_PERIOD", "Period (ms)", "%.0f", 100, 60000, 50, 500);
+    IUFillNumber(&PollSetN[POLL_MIN], "POLL_MIN", "Adaptive Min (ms)", "%.0f", 100, 60000, 50, 250);
+    IUFillNumber(&PollSetN[POLL_MAX], "POLL_MAX", "Adaptive Max (ms)", "%.0f", 100, 60000, 50, 5000);
+    IUFillNumberVector(&PollSetNP, PollSetN, PollSet_N, getDeviceName(), "POLL_SETTINGS", "Poll Period", DIAG_TAB, IP_RW, 60, IPS_IDLE);
+    
+    // focuser tracking while moving
+    IUFillSwitch(&FocusTrackS[TRACK_ON], "TRACK_ON", "On", ISS_ON);
+    IUFillSwitch(&FocusTrackS[TRACK_OFF], "TRACK_OFF", "Off", ISS_OFF);
+    IUFillSwitchVector(&FocusTrackSP, FocusTrackS, FocusTrack_N, getDeviceName(), "FOCUS_TRACK", "Move Tracking", FOCUS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    
+    IUFillNumber(&FocusTrackN[TRACK_PERIOD], "TRACK_PERIOD", "Period (ms)", "%.0f", 20, 1000, 10, 50);
+    IUFillNumber(&FocusTrackN[TRACK_CLIENT_HZ], "TRACK_CLIENT_HZ", "Client rate (Hz)", "%.0f", 0, 20, 1, 5);
+    IUFillNumberVector(&FocusTrackNP, FocusTrackN, FocusTrackSet_N, getDeviceName(), "FOCUS_TRACK_PERIOD", "Tracking", FOCUS_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillNumber(&FocusEtaN[ETA_REMAINING], "ETA_REMAINING", "Remaining (s)", "%.1f", 0, 86400, 0, 0);
+    IUFillNumber(&FocusEtaN[ETA_TOTAL], "ETA_TOTAL", "Move (s)", "%.1f", 0, 86400, 0, 0);
+    IUFillNumberVector(&FocusEtaNP, FocusEtaN, FocusEta_N, getDeviceName(), "FOCUS_ETA", "Move ETA", FOCUS_TAB, IP_RO, 60, IPS_IDLE);
+    
+    // queued focus sweep, per target arrivals in FOCUS_QUEUE_STATUS
+    IUFillText(&FocusQueueT[0], "QUEUE_TARGETS", "Targets", "");
+    IUFillTextVector(&FocusQueueTP, FocusQueueT, 1, getDeviceName(), "FOCUS_QUEUE", "Queue", FOCUS_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillNumber(&FocusQueueSetN[0], "QUEUE_OVERSHOOT", "Overshoot (steps)", "%.0f", 0, 5000, 10, 0);
+    IUFillNumberVector(&FocusQueueSetNP, FocusQueueSetN, 1, getDeviceName(), "FOCUS_QUEUE_SETTINGS", "Queue", FOCUS_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillNumber(&FocusQueueN[QUEUE_REACHED], "QUEUE_REACHED", "Reached", "%.0f", 0, PS_QUEUE_MAX, 0, 0);
+    IUFillNumber(&FocusQueueN[QUEUE_TARGETS], "QUEUE_TARGETS", "Targets", "%.0f", 0, PS_QUEUE_MAX, 0, 0);
+    IUFillNumber(&FocusQueueN[QUEUE_POSITION], "QUEUE_POSITION", "Position", "%.0f", 0, 1048575, 0, 0);
+    IUFillNumber(&FocusQueueN[QUEUE_STEP_MS], "QUEUE_STEP_MS", "Step (ms)", "%.0f", 0, 1e7, 0, 0);
+    IUFillNumberVector(&FocusQueueNP, FocusQueueN, FocusQueue_N, getDeviceName(), "FOCUS_QUEUE_STATUS", "Queue", FOCUS_TAB, IP_RO, 60, IPS_IDLE);
+    queueTargets.reserve(PS_QUEUE_MAX);
+    
+    // driver temperature compensation, fitted from recorded best focus positions
+    IUFillSwitch(&TcompS[TC_ON], "TC_ON", "On", ISS_OFF);
+    IUFillSwitch(&TcompS[TC_OFF], "TC_OFF", "Off", ISS_ON);
+    IUFillSwitchVector(&TcompSP, TcompS, Tcomp_N, getDeviceName(), "FOCUS_TCOMP_DRIVER", "Driver TC", FOCUS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    
+    IUFillNumber(&TcompSetN[TC_HYSTERESIS], "TC_HYSTERESIS", "Hysteresis (steps)", "%.0f", 1, 1000, 1, 10);
+    IUFillNumber(&TcompSetN[TC_MAX_STEP], "TC_MAX_STEP", "Max move (steps)", "%.0f", 1, 5000, 10, 50);
+    IUFillNumber(&TcompSetN[TC_INTERVAL], "TC_INTERVAL", "Min interval (s)", "%.0f", 0, 3600, 10, 60);
+    IUFillNumberVector(&TcompSetNP, TcompSetN, TcompSet_N, getDeviceName(), "FOCUS_TCOMP_SETTINGS", "Driver TC", FOCUS_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillSwitch(&TcompPointsS[TC_RECORD], "TC_RECORD", "Record Focus", ISS_OFF);
+    IUFillSwitch(&TcompPointsS[TC_CLEAR], "TC_CLEAR", "Clear", ISS_OFF);
+    IUFillSwitchVector(&TcompPointsSP, TcompPointsS, TcompPoints_N, getDeviceName(), "FOCUS_TCOMP_POINTS", "TC Points", FOCUS_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+    
+    IUFillNumber(&TcompModelN[TC_POINTS], "TC_POINTS", "Points", "%.0f", 0, 1e6, 0, 0);
+    IUFillNumber(&TcompModelN[TC_ORDER], "TC_ORDER", "Order", "%.0f", 0, 2, 0, 0);
+    IUFillNumber(&TcompModelN[TC_SLOPE], "TC_SLOPE", "Steps/C", "%.1f", -1e6, 1e6, 0, 0);
+    IUFillNumber(&TcompModelN[TC_OFFSET], "TC_OFFSET", "Offset (steps)", "%.0f", -1e6, 1e6, 0, 0);
+    IUFillNumberVector(&TcompModelNP, TcompModelN, TcompModel_N, getDeviceName(), "FOCUS_TCOMP_MODEL", "TC Model", FOCUS_TAB, IP_RO, 60, IPS_IDLE);
+    
+    // focus log, record a run and go to the prediction from past ones
+    IUFillNumber(&FocusLogN[0], "LOG_HFR", "HFR (0 unknown)", "%.2f", 0, 100, 0, 0);
+    IUFillNumberVector(&FocusLogNP, FocusLogN, 1, getDeviceName(), "FOCUS_LOG_RECORD", "Log Focus", FOCUS_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillSwitch(&FocusLogJumpS[LOG_JUMP_AUTO], "LOG_JUMP_AUTO", "Auto", ISS_OFF);
+    IUFillSwitch(&FocusLogJumpS[LOG_JUMP_OFF], "LOG_JUMP_OFF", "Off", ISS_ON);
+    IUFillSwitchVector(&FocusLogJumpSP, FocusLogJumpS, FocusLogJump_N, getDeviceName(), "FOCUS_LOG_JUMP", "Log Jump", FOCUS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    
+    IUFillSwitch(&FocusLogGoS[0], "LOG_GO", "Go to Predicted", ISS_OFF);
+    IUFillSwitchVector(&FocusLogGoSP, FocusLogGoS, 1, getDeviceName(), "FOCUS_LOG_GO", "Log Jump", FOCUS_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+    
+    IUFillNumber(&FocusLogPredN[LOG_ENTRIES], "LOG_ENTRIES", "Entries", "%.0f", 0, 1e9, 0, 0);
+    IUFillNumber(&FocusLogPredN[LOG_PREDICTED], "LOG_PREDICTED", "Predicted", "%.0f", 0, 1048575, 0, 0);
+    IUFillNumber(&FocusLogPredN[LOG_NEAREST_DT], "LOG_NEAREST_DT", "Within (C)", "%.1f", 0, 1000, 0, 0);
+    IUFillNumberVector(&FocusLogPredNP, FocusLogPredN, FocusLogPred_N, getDeviceName(), "FOCUS_LOG_PREDICTION", "Log Prediction", FOCUS_TAB, IP_RO, 60, IPS_IDLE);
+    
+    // camera to snoop, compensation moves wait for its exposures to end;
+    // filter wheel, the focus log is kept per filter
+    IUFillText(&ActiveDevicesT[SNOOP_CCD], "ACTIVE_CCD", "CCD", "");
+    IUFillText(&ActiveDevicesT[SNOOP_FILTER], "ACTIVE_FILTER", "Filter", "");
+    IUFillTextVector(&ActiveDevicesTP, ActiveDevicesT, ActiveDevices_N, getDeviceName(), "ACTIVE_DEVICES", "Snoop devices", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    
+    IUFillSwitch(&DiagResetS[0], "DIAG_RESET", "Reset", ISS_OFF);
+    IUFillSwitchVector(&DiagResetSP, DiagResetS, 1, getDeviceName(), "DIAG_RESET", "Statistics", DIAG_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+    
+    // span trace (builds with POWERSTAR_TRACE), written to the journal directory
+    IUFillSwitch(&TraceDumpS[0], "TRACE_DUMP", "Dump", ISS_OFF);
+    IUFillSwitchVector(&TraceDumpSP, TraceDumpS, 1, getDeviceName(), "TRACE_DUMP", "Trace", DIAG_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+    
     return true;
 }
 
@@ -563,7 +874,7 @@ bool PSpower::updateProperties()
 
 	if (isConnected())
     {
-        psctl.getStatus();
+        // Connect() has just read the hub
 
         // Main tab
         defineNumber(&PowerSensorsNP);
@@ -611,12 +922,34 @@ bool PSpower::updateProperties()
         
         // Focus Tab
         FI::updateProperties();
+        defineSwitch(&FocusTrackSP);
+        defineNumber(&FocusTrackNP);
+        defineNumber(&FocusEtaNP);
+        defineText(&FocusQueueTP);
+        defineNumber(&FocusQueueSetNP);
+        defineNumber(&FocusQueueNP);
+        defineSwitch(&TcompSP);
+        defineNumber(&TcompSetNP);
+        defineSwitch(&TcompPointsSP);
+        tcomp.load(tcompPath());
+        publishTcomp();
+        defineNumber(&TcompModelNP);
+        defineNumber(&FocusLogNP);
+        defineSwitch(&FocusLogJumpSP);
+        defineSwitch(&FocusLogGoSP);
+        if (!focusLog.open(focusLogPath()))
+            LOGF_ERROR("Unable to read %s, focus log not used", focusLogPath().c_str());
+        logJumpPending = true;
+        logPredTemp = -273;
+        defineNumber(&FocusLogPredNP);
+        defineText(&ActiveDevicesTP);
         
         // Power tab
         defineSwitch(&PortCtlSP);
         defineLight(&PORTlightsLP);
         defineSwitch(&AllSP);
         defineNumber(&PortCurrentNP);
+        defineNumber(&EnergyNP);
         defineText(&PortLabelsTP);
         
         // USB tab
@@ -647,6 +980,39 @@ bool PSpower::updateProperties()
         
         // User Limits
         defineNumber(&UserLimitsNP);
+        
+        // Telemetry tab
+        defineText(&HistoryQueryTP);
+        defineBLOB(&HistoryBP);
+        defineSwitch(&JournalSP);
+        defineText(&JournalDirTP);
+        defineNumber(&JournalSetNP);
+        defineSwitch(&ExportSP);
+        defineSwitch(&BurstChanSP);
+        defineNumber(&BurstSetNP);
+        defineSwitch(&BurstSP);
+        defineNumber(&BurstStatsNP);
+        defineBLOB(&BurstBP);
+        defineSwitch(&MetricsSP);
+        defineText(&MetricsPathTP);
+        defineNumber(&MetricsPeriodNP);
+        
+        // Diagnostics tab
+        publishDiag();
+        publishPoll();
+        defineNumber(&PollStatsNP);
+        defineSwitch(&PollModeSP);
+        defineNumber(&PollSetNP);
+        defineNumber(&DiagCountsNP);
+        defineText(&DiagLatencyTP);
+        defineSwitch(&DiagResetSP);
+        defineSwitch(&TraceDumpSP);
+        
+        // the saved settings that write to the hub, once per connect and
+        // only after it has been read (the hub keeps its own profile,
+        // autoboot and fault mask, readHub() shows those)
+        loadConfig(true, USBpwSP.name);
+        loadConfig(true, DEWpercentNP.name);
     
     }
     else
@@ -685,6 +1051,7 @@ bool PSpower::updateProperties()
         deleteProperty(PortLabelsTP.name);
         deleteProperty(AllSP.name);
         deleteProperty(PortCurrentNP.name);
+        deleteProperty(EnergyNP.name);
         
         // USB tab
         deleteProperty(USBLabelsTP.name);
@@ -710,10 +1077,51 @@ bool PSpower::updateProperties()
         deleteProperty(FaultStatusLP.name);
         
         FI::updateProperties();
+        deleteProperty(FocusTrackSP.name);
+        deleteProperty(FocusTrackNP.name);
+        deleteProperty(FocusEtaNP.name);
+        deleteProperty(FocusQueueTP.name);
+        deleteProperty(FocusQueueSetNP.name);
+        deleteProperty(FocusQueueNP.name);
+        deleteProperty(TcompSP.name);
+        deleteProperty(TcompSetNP.name);
+        deleteProperty(TcompPointsSP.name);
+        deleteProperty(TcompModelNP.name);
+        deleteProperty(FocusLogNP.name);
+        deleteProperty(FocusLogJumpSP.name);
+        deleteProperty(FocusLogGoSP.name);
+        deleteProperty(FocusLogPredNP.name);
+        focusLog.close();
+        deleteProperty(ActiveDevicesTP.name);
         WI::updateProperties();
         
         // User Limits
         deleteProperty(UserLimitsNP.name);
+        
+        // Telemetry tab
+        deleteProperty(HistoryQueryTP.name);
+        deleteProperty(HistoryBP.name);
+        deleteProperty(JournalSP.name);
+        deleteProperty(JournalDirTP.name);
+        deleteProperty(JournalSetNP.name);
+        deleteProperty(ExportSP.name);
+        deleteProperty(BurstChanSP.name);
+        deleteProperty(BurstSetNP.name);
+        deleteProperty(BurstSP.name);
+        deleteProperty(BurstStatsNP.name);
+        deleteProperty(BurstBP.name);
+        deleteProperty(MetricsSP.name);
+        deleteProperty(MetricsPathTP.name);
+        deleteProperty(MetricsPeriodNP.name);
+        
+        // Diagnostics tab
+        deleteProperty(PollStatsNP.name);
+        deleteProperty(PollModeSP.name);
+        deleteProperty(PollSetNP.name);
+        deleteProperty(DiagCountsNP.name);
+        deleteProperty(DiagLatencyTP.name);
+        deleteProperty(DiagResetSP.name);
+        deleteProperty(TraceDumpSP.name);
     }
     return true;
 }
@@ -724,6 +1132,8 @@ bool PSpower::updateProperties()
 bool PSpower::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[],
                                  int n)
 {
+    PS_TRACE_SPAN_ARG("ISNewSwitch", name);
+    
     if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
     {
         // Clear Power fields
@@ -731,7 +1141,10 @@ bool PSpower::ISNewSwitch(const char *dev, const char *name, ISState *states, ch
         {
             IUUpdateSwitch(&PowerClearSP, states, names, n);
             
-            AmpHrs = WattHrs = 0.0;
+            energy.reset();
+            publishEnergy();
+            IDSetNumber(&PowerSensorsNP, nullptr);
+            saveConfig(true, EnergyNP.name);
             
             PowerClearS[0].s = ISS_OFF;
             PowerClearSP.s = IPS_OK;
@@ -1325,6 +1738,252 @@ bool PSpower::ISNewSwitch(const char *dev, const char *name, ISState *states, ch
         **/
 
         
+        // Telemetry journal on/off
+        if (strcmp(name, JournalSP.name) == 0)
+        {
+            IUUpdateSwitch(&JournalSP, states, names, n);
+            
+            if (IUFindOnSwitchIndex(&JournalSP) == JOURNAL_ON) {
+                if (journal.open(JournalDirT[0].text, uint32_t(JournalSetN[JOURNAL_SEGMENT_MB].value), uint32_t(JournalSetN[JOURNAL_KEEP].value))) {
+                    LOGF_INFO("Journaling telemetry to %s", journal.segmentName().c_str());
+                    JournalSP.s = IPS_OK;
+                }
+                else {
+                    LOGF_ERROR("Unable to start journal in %s", JournalDirT[0].text);
+                    IUResetSwitch(&JournalSP);
+                    JournalS[JOURNAL_OFF].s = ISS_ON;
+                    JournalSP.s = IPS_ALERT;
+                }
+            }
+            else {
+                journal.close();
+                JournalSP.s = IPS_IDLE;
+            }
+            
+            IDSetSwitch(&JournalSP, nullptr);
+            return true;
+        }
+        
+        // Prometheus metrics off/textfile/socket
+        if (strcmp(name, MetricsSP.name) == 0)
+        {
+            IUUpdateSwitch(&MetricsSP, states, names, n);
+            
+            if (IUFindOnSwitchIndex(&MetricsSP) == METRICS_OFF) {
+                stopMetrics();
+                MetricsSP.s = IPS_IDLE;
+            }
+            else if (startMetrics())
+                MetricsSP.s = IPS_OK;
+            else {
+                IUResetSwitch(&MetricsSP);
+                MetricsS[METRICS_OFF].s = ISS_ON;
+                MetricsSP.s = IPS_ALERT;
+            }
+            
+            IDSetSwitch(&MetricsSP, nullptr);
+            return true;
+        }
+        
+        // Compressed telemetry export on/off
+        if (strcmp(name, ExportSP.name) == 0)
+        {
+            IUUpdateSwitch(&ExportSP, states, names, n);
+            
+            if (IUFindOnSwitchIndex(&ExportSP) == EXPORT_ON) {
+                if (exporter.isOpen() || exporter.open(JournalDirT[0].text)) {
+                    LOGF_INFO("Exporting telemetry to %s", exporter.fileName().c_str());
+                    ExportSP.s = IPS_OK;
+                }
+                else {
+                    LOGF_ERROR("Unable to start export in %s", JournalDirT[0].text);
+                    IUResetSwitch(&ExportSP);
+                    ExportS[EXPORT_OFF].s = ISS_ON;
+                    ExportSP.s = IPS_ALERT;
+                }
+            }
+            else {
+                if (!exporter.close())
+                    LOGF_ERROR("Error finishing telemetry export %s", exporter.fileName().c_str());
+                ExportSP.s = IPS_IDLE;
+            }
+            
+            IDSetSwitch(&ExportSP, nullptr);
+            return true;
+        }
+        
+        // Burst channel
+        if (strcmp(name, BurstChanSP.name) == 0)
+        {
+            IUUpdateSwitch(&BurstChanSP, states, names, n);
+            BurstChanSP.s = IPS_OK;
+            IDSetSwitch(&BurstChanSP, nullptr);
+            return true;
+        }
+        
+        // Start a burst capture, polling pauses until it is done
+        if (strcmp(name, BurstSP.name) == 0)
+        {
+            IUUpdateSwitch(&BurstSP, states, names, n);
+            
+            if (BurstS[0].s == ISS_ON) {
+                uint8_t channel = psBurstChannels[IUFindOnSwitchIndex(&BurstChanSP)];
+                if (burst.start(&psctl, channel, BurstSetN[BURST_SECONDS].value, BurstSetN[BURST_THRESHOLD].value)) {
+                    LOGF_INFO("Burst capture of %s for %.1f s", psChannels[channel].name, BurstSetN[BURST_SECONDS].value);
+                    BurstSP.s = IPS_BUSY;
+                }
+                else {
+                    LOG_ERROR("Unable to start burst capture");
+                    BurstS[0].s = ISS_OFF;
+                    BurstSP.s = IPS_ALERT;
+                }
+            }
+            else if (burst.isActive()) {
+                // can't be cut short, let the finish show
+                BurstS[0].s = ISS_ON;
+            }
+            
+            IDSetSwitch(&BurstSP, nullptr);
+            return true;
+        }
+        
+        // Fast focuser polling during moves
+        if (strcmp(name, FocusTrackSP.name) == 0)
+        {
+            IUUpdateSwitch(&FocusTrackSP, states, names, n);
+            if (FocusTrackS[TRACK_OFF].s == ISS_ON)
+                stopTracking();
+            FocusTrackSP.s = IPS_OK;
+            IDSetSwitch(&FocusTrackSP, nullptr);
+            return true;
+        }
+        
+        // Driver temperature compensation, not on top of the hub's own
+        if (strcmp(name, TcompSP.name) == 0)
+        {
+            IUUpdateSwitch(&TcompSP, states, names, n);
+            TcompSP.s = IPS_OK;
+            if (TcompS[TC_ON].s == ISS_ON && curProfile.tempSensor != 0) {
+                LOG_WARN("Driver temperature compensation needs the hub's Temp Comp set to None");
+                IUResetSwitch(&TcompSP);
+                TcompS[TC_OFF].s = ISS_ON;
+                TcompSP.s = IPS_ALERT;
+            }
+            else if (TcompS[TC_ON].s == ISS_ON && !tcomp.valid())
+                LOG_WARN("Driver temperature compensation waits for recorded focus points over at least 1 C");
+            else if (TcompS[TC_ON].s == ISS_ON && !ActiveDevicesT[SNOOP_CCD].text[0])
+                LOG_WARN("Driver temperature compensation waits for a camera in Options 'Snoop devices'");
+            
+            // compensate from wherever the focuser is now
+            tcomp.unanchor();
+            IDSetSwitch(&TcompSP, nullptr);
+            return true;
+        }
+        
+        // Best focus at the current temperature, or forget all of them
+        if (strcmp(name, TcompPointsSP.name) == 0)
+        {
+            IUUpdateSwitch(&TcompPointsSP, states, names, n);
+            TcompPointsSP.s = IPS_OK;
+            
+            if (TcompPointsS[TC_RECORD].s == ISS_ON) {
+                double t = tempC();
+                uint32_t pos = FocusAbsPosN[0].value;
+                tcomp.add(t, pos);
+                tcomp.anchor(t, pos);
+                if (!tcomp.save(tcompPath(), t, pos)) {
+                    LOGF_ERROR("Unable to write %s", tcompPath().c_str());
+                    TcompPointsSP.s = IPS_ALERT;
+                }
+                LOGF_INFO("Recorded focus %u at %.1f C", pos, t);
+            }
+            else if (TcompPointsS[TC_CLEAR].s == ISS_ON) {
+                tcomp.clear();
+                unlink(tcompPath().c_str());
+                LOG_INFO("Temperature compensation points cleared");
+            }
+            
+            IUResetSwitch(&TcompPointsSP);
+            IDSetSwitch(&TcompPointsSP, nullptr);
+            publishTcomp();
+            return true;
+        }
+        
+        // Jump to the focus log's prediction on connect and filter changes
+        if (strcmp(name, FocusLogJumpSP.name) == 0)
+        {
+            IUUpdateSwitch(&FocusLogJumpSP, states, names, n);
+            FocusLogJumpSP.s = IPS_OK;
+            IDSetSwitch(&FocusLogJumpSP, nullptr);
+            return true;
+        }
+        
+        // or now
+        if (strcmp(name, FocusLogGoSP.name) == 0)
+        {
+            IUResetSwitch(&FocusLogGoSP);
+            FocusLogGoSP.s = jumpToPredicted("Focus log") ? IPS_OK : IPS_ALERT;
+            IDSetSwitch(&FocusLogGoSP, nullptr);
+            return true;
+        }
+        
+        // Fixed or adaptive poll period
+        if (strcmp(name, PollModeSP.name) == 0)
+        {
+            IUUpdateSwitch(&PollModeSP, states, names, n);
+            poll.adaptive = IUFindOnSwitchIndex(&PollModeSP) == POLL_ADAPTIVE;
+            PollModeSP.s = IPS_OK;
+            IDSetSwitch(&PollModeSP, nullptr);
+            return true;
+        }
+        
+        // Zero the USB command statistics
+        if (strcmp(name, DiagResetSP.name) == 0)
+        {
+            IUUpdateSwitch(&DiagResetSP, states, names, n);
+            
+            psDiag().reset();
+            publishDiag();
+            IDSetNumber(&DiagCountsNP, nullptr);
+            IDSetText(&DiagLatencyTP, nullptr);
+            
+            DiagResetS[0].s = ISS_OFF;
+            DiagResetSP.s = IPS_OK;
+            IDSetSwitch(&DiagResetSP, nullptr);
+            return true;
+        }
+        
+        // Write the span trace as Chrome trace JSON
+        if (strcmp(name, TraceDumpSP.name) == 0)
+        {
+            IUUpdateSwitch(&TraceDumpSP, states, names, n);
+            
+            char stamp[32];
+            time_t now = time(nullptr);
+            struct tm tmv;
+            localtime_r(&now, &tmv);
+            strftime(stamp, sizeof(stamp), "/trace-%Y%m%d-%H%M%S.json", &tmv);
+            mkdir(JournalDirT[0].text, 0755);
+            string path = string(JournalDirT[0].text) + stamp;
+            
+            if (!psTraceEnabled()) {
+                LOG_ERROR("Driver was built without POWERSTAR_TRACE, no trace to dump");
+                TraceDumpSP.s = IPS_ALERT;
+            }
+            else if (psTraceDump(path.c_str())) {
+                LOGF_INFO("Trace written to %s", path.c_str());
+                TraceDumpSP.s = IPS_OK;
+            }
+            else {
+                LOGF_ERROR("Unable to write trace %s", path.c_str());
+                TraceDumpSP.s = IPS_ALERT;
+            }
+            
+            TraceDumpS[0].s = ISS_OFF;
+            IDSetSwitch(&TraceDumpSP, nullptr);
+            return true;
+        }
+        
         // Reboot Power*Star Hub
         if (strcmp(name, RebootSP.name) == 0)
         {
@@ -1480,6 +2139,8 @@ bool PSpower::ISNewSwitch(const char *dev, const char *name, ISState *states, ch
 /***************************************************************/
 bool PSpower::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
 {
+    PS_TRACE_SPAN_ARG("ISNewText", name);
+    
     if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
     {
         // Port names
@@ -1514,6 +2175,70 @@ bool PSpower::ISNewText(const char *dev, const char *name, char *texts[], char *
             return true;
         }
         
+        // Journal directory, used from the next time the journal is started
+        if (strcmp(name, JournalDirTP.name) == 0)
+        {
+            IUUpdateText(&JournalDirTP, texts, names, n);
+            JournalDirTP.s = IPS_OK;
+            IDSetText(&JournalDirTP, nullptr);
+            return true;
+        }
+        
+        // Focus sweep: absolute targets separated by spaces or commas
+        if (strcmp(name, FocusQueueTP.name) == 0)
+        {
+            IUUpdateText(&FocusQueueTP, texts, names, n);
+            FocusQueueTP.s = startQueue() ? IPS_BUSY : IPS_ALERT;
+            IDSetText(&FocusQueueTP, nullptr);
+            return true;
+        }
+        
+        // Camera whose exposures compensation moves wait for
+        if (strcmp(name, ActiveDevicesTP.name) == 0)
+        {
+            // the config is sent again on every client connect, only a
+            // different device forgets what the old one said
+            string ccd = ActiveDevicesT[SNOOP_CCD].text;
+            string wheel = ActiveDevicesT[SNOOP_FILTER].text;
+            IUUpdateText(&ActiveDevicesTP, texts, names, n);
+            
+            if (ccd != ActiveDevicesT[SNOOP_CCD].text) {
+                ccdBusy = false;
+                if (ActiveDevicesT[SNOOP_CCD].text[0])
+                    IDSnoopDevice(ActiveDevicesT[SNOOP_CCD].text, "CCD_EXPOSURE");
+            }
+            if (wheel != ActiveDevicesT[SNOOP_FILTER].text) {
+                filterNames.clear();
+                filterSlot = 0;
+                filterName.clear();
+                if (ActiveDevicesT[SNOOP_FILTER].text[0]) {
+                    IDSnoopDevice(ActiveDevicesT[SNOOP_FILTER].text, "FILTER_SLOT");
+                    IDSnoopDevice(ActiveDevicesT[SNOOP_FILTER].text, "FILTER_NAME");
+                }
+            }
+            ActiveDevicesTP.s = IPS_OK;
+            IDSetText(&ActiveDevicesTP, nullptr);
+            return true;
+        }
+        
+        // Metrics textfile and socket paths, used the next time metrics are switched on
+        if (strcmp(name, MetricsPathTP.name) == 0)
+        {
+            IUUpdateText(&MetricsPathTP, texts, names, n);
+            MetricsPathTP.s = IPS_OK;
+            IDSetText(&MetricsPathTP, nullptr);
+            return true;
+        }
+        
+        // Telemetry history query
+        if (strcmp(name, HistoryQueryTP.name) == 0)
+        {
+            IUUpdateText(&HistoryQueryTP, texts, names, n);
+            HistoryQueryTP.s = queryHistory() ? IPS_OK : IPS_ALERT;
+            IDSetText(&HistoryQueryTP, nullptr);
+            return true;
+        }
+        
         return true;
     }
     
@@ -1526,8 +2251,30 @@ bool PSpower::ISNewText(const char *dev, const char *name, char *texts[], char *
 /***************************************************************/
 bool PSpower::ISNewNumber(const char * dev, const char * name, double values[], char * names[], int n)
 {
+    PS_TRACE_SPAN_ARG("ISNewNumber", name);
+    
     if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
     {
+        // Energy totals, only set from the saved config; after that the
+        // running totals are newer than anything saved, and it is read only
+        if (strcmp(name, EnergyNP.name) == 0)
+        {
+            if (energyLoaded)
+            {
+                EnergyNP.s = IPS_ALERT;
+                IDSetNumber(&EnergyNP, "Energy totals are read only");
+                return true;
+            }
+            IUUpdateNumber(&EnergyNP, values, names, n);
+            for (int p = 0; p < PSEnergy::PS_E_N; p++) {
+                energy.ampHrs[p] = EnergyN[p * 2].value;
+                energy.wattHrs[p] = EnergyN[p * 2 + 1].value;
+            }
+            publishEnergy();
+            IDSetNumber(&PowerSensorsNP, nullptr);
+            return true;
+        }
+        
         // LED brightness
         // TODO test if this is working
         if (strcmp(name, PowerLEDNP.name) == 0)
@@ -1615,6 +2362,105 @@ bool PSpower::ISNewNumber(const char * dev, const char * name, double values[],
             return true;
         }
         
+        // Journal segment size and retention
+        if (strcmp(name, JournalSetNP.name) == 0)
+        {
+            IUUpdateNumber(&JournalSetNP, values, names, n);
+            JournalSetNP.s = IPS_OK;
+            IDSetNumber(&JournalSetNP, nullptr);
+            return true;
+        }
+        
+        // Overshoot for queued targets approached against the preferred direction
+        if (strcmp(name, FocusQueueSetNP.name) == 0)
+        {
+            IUUpdateNumber(&FocusQueueSetNP, values, names, n);
+            FocusQueueSetNP.s = IPS_OK;
+            IDSetNumber(&FocusQueueSetNP, nullptr);
+            return true;
+        }
+        
+        // A focus run finished here, with this HFR if the client has one
+        if (strcmp(name, FocusLogNP.name) == 0)
+        {
+            IUUpdateNumber(&FocusLogNP, values, names, n);
+            FocusLogNP.s = IPS_OK;
+            
+            if (FocusAbsPosNP.s == IPS_BUSY || FocusRelPosNP.s == IPS_BUSY) {
+                LOG_WARN("Focuser is moving, not logged");
+                FocusLogNP.s = IPS_ALERT;
+            }
+            else {
+                psFocusRecord r;
+                memset(&r, 0, sizeof(r));
+                strncpy(r.filter, filterName.c_str(), sizeof(r.filter) - 1);
+                r.tempC = tempC();
+                r.humidity = Hum;
+                r.hfr = FocusLogN[0].value;
+                r.position = FocusAbsPosN[0].value;
+                r.timeSec = time(nullptr);
+                
+                if (!focusLog.add(r)) {
+                    LOGF_ERROR("Unable to write %s", focusLogPath().c_str());
+                    FocusLogNP.s = IPS_ALERT;
+                }
+                else
+                    LOGF_INFO("Logged focus %u at %.1f C%s%s", r.position, r.tempC, r.filter[0] ? ", " : "", r.filter);
+            }
+            
+            IDSetNumber(&FocusLogNP, nullptr);
+            publishFocusLog();
+            return true;
+        }
+        
+        // Driver temperature compensation limits
+        if (strcmp(name, TcompSetNP.name) == 0)
+        {
+            IUUpdateNumber(&TcompSetNP, values, names, n);
+            tcomp.hysteresis = TcompSetN[TC_HYSTERESIS].value;
+            tcomp.maxStep = TcompSetN[TC_MAX_STEP].value;
+            tcomp.intervalSec = TcompSetN[TC_INTERVAL].value;
+            TcompSetNP.s = IPS_OK;
+            IDSetNumber(&TcompSetNP, nullptr);
+            return true;
+        }
+        
+        // Focuser tracking period and client update rate
+        if (strcmp(name, FocusTrackNP.name) == 0)
+        {
+            IUUpdateNumber(&FocusTrackNP, values, names, n);
+            FocusTrackNP.s = IPS_OK;
+            IDSetNumber(&FocusTrackNP, nullptr);
+            return true;
+        }
+        
+        // Poll period and adaptive limits
+        if (strcmp(name, PollSetNP.name) == 0)
+        {
+            IUUpdateNumber(&PollSetNP, values, names, n);
+            
+            if (PollSetN[POLL_MIN].value > PollSetN[POLL_MAX].value) {
+                LOG_WARN("Poll minimum is above the maximum, using the minimum for both");
+                PollSetN[POLL_MAX].value = PollSetN[POLL_MIN].value;
+            }
+            poll.basePeriod = PollSetN[POLL_PERIOD].value;
+            poll.minPeriod = PollSetN[POLL_MIN].value;
+            poll.maxPeriod = PollSetN[POLL_MAX].value;
+            
+            PollSetNP.s = IPS_OK;
+            IDSetNumber(&PollSetNP, nullptr);
+            return true;
+        }
+        
+        // Metrics update period
+        if (strcmp(name, MetricsPeriodNP.name) == 0)
+        {
+            IUUpdateNumber(&MetricsPeriodNP, values, names, n);
+            MetricsPeriodNP.s = IPS_OK;
+            IDSetNumber(&MetricsPeriodNP, nullptr);
+            return true;
+        }
+        
         // Backlash TODO
         if (strcmp(name, MtrProfNP.name) == 0)
         {
@@ -1648,10 +2494,7 @@ bool PSpower::saveConfigItems(FILE *fp)
     IUSaveConfigNumber(fp, &DEWpercentNP);
     IUSaveConfigSwitch(fp, &AutoDewSP);
     IUSaveConfigSwitch(fp, &USBpwSP);
-    IUSaveConfigNumber(fp, &FaultMaskNP);
-    IUSaveConfigSwitch(fp, &AutoBootSP);
     IUSaveConfigSwitch(fp, &ProfileDevSP);
-    IUSaveConfigSwitch(fp, &TemplateSP);
     IUSaveConfigSwitch(fp, &MtrTypeSP);
     IUSaveConfigSwitch(fp, &PrefDirSP);
     IUSaveConfigSwitch(fp, &RevMtrSP);
@@ -1659,6 +2502,21 @@ bool PSpower::saveConfigItems(FILE *fp)
     IUSaveConfigNumber(fp, &MtrProfNP);
     IUSaveConfigSwitch(fp, &PermFocSP);
     IUSaveConfigNumber(fp, &NoneDisplayNP);
+    IUSaveConfigText(fp, &JournalDirTP);
+    IUSaveConfigNumber(fp, &JournalSetNP);
+    IUSaveConfigNumber(fp, &EnergyNP);
+    IUSaveConfigText(fp, &MetricsPathTP);
+    IUSaveConfigNumber(fp, &MetricsPeriodNP);
+    IUSaveConfigSwitch(fp, &MetricsSP);
+    IUSaveConfigSwitch(fp, &PollModeSP);
+    IUSaveConfigNumber(fp, &PollSetNP);
+    IUSaveConfigSwitch(fp, &FocusTrackSP);
+    IUSaveConfigNumber(fp, &FocusTrackNP);
+    IUSaveConfigSwitch(fp, &TcompSP);
+    IUSaveConfigNumber(fp, &TcompSetNP);
+    IUSaveConfigNumber(fp, &FocusQueueSetNP);
+    IUSaveConfigSwitch(fp, &FocusLogJumpSP);
+    IUSaveConfigText(fp, &ActiveDevicesTP);
     return true;
 }
 
@@ -1668,14 +2526,9 @@ void PSpower::ISGetProperties(const char *dev)
     DefaultDevice::ISGetProperties(dev);
     loadConfig(true, PortLabelsTP.name);
     loadConfig(true, USBLabelsTP.name);
-    loadConfig(true, USBpwSP.name);
-    loadConfig(true, DEWpercentNP.name);
     loadConfig(true, DewLabelsTP.name);
-    loadConfig(true, FaultMaskNP.name);
-    loadConfig(true, AutoBootSP.name);
     loadConfig(true, AutoDewSP.name);
     loadConfig(true, ProfileDevSP.name);
-    loadConfig(true, TemplateSP.name);
     loadConfig(true, MtrTypeSP.name);
     loadConfig(true, PrefDirSP.name);
     loadConfig(true, RevMtrSP.name);
@@ -1683,6 +2536,25 @@ void PSpower::ISGetProperties(const char *dev)
     loadConfig(true, MtrProfNP.name);
     loadConfig(true, PermFocSP.name);
     loadConfig(true, NoneDisplayNP.name);
+    loadConfig(true, JournalDirTP.name);
+    loadConfig(true, JournalSetNP.name);
+    if (!energyLoaded)
+    {
+        loadConfig(true, EnergyNP.name);
+        energyLoaded = true;
+    }
+    loadConfig(true, MetricsPathTP.name);
+    loadConfig(true, MetricsPeriodNP.name);
+    loadConfig(true, MetricsSP.name);
+    loadConfig(true, PollModeSP.name);
+    loadConfig(true, PollSetNP.name);
+    loadConfig(true, FocusTrackSP.name);
+    loadConfig(true, FocusTrackNP.name);
+    loadConfig(true, ActiveDevicesTP.name);
+    loadConfig(true, TcompSP.name);
+    loadConfig(true, TcompSetNP.name);
+    loadConfig(true, FocusQueueSetNP.name);
+    loadConfig(true, FocusLogJumpSP.name);
 }
 
 /***************************************************************/
@@ -1696,10 +2568,12 @@ IPState PSpower::updateWeather()
     DewPt = Temp - ((100 - Hum)/5.0);
     DpDep = (Temp - DewPt) * -1;
     
-    setParameterValue("WEATHER_TEMPERATURE", Temp);
-    setParameterValue("WEATHER_HUMIDITY", Hum);
-    setParameterValue("WEATHER_DEW_POINT", DewPt);
-    setParameterValue("WEATHER_DP_DEP", DpDep);
+    // same as setParameterValue() without a std::string per call
+    float values[WP_N] = { Temp, Hum, DewPt, DpDep };
+    for (int i = 0; i < WP_N; i++) {
+        if (weatherParam[i] != nullptr)
+            weatherParam[i]->value = values[i];
+    }
     
     WEATHERN[TEMP].value = Temp;
     WEATHERN[HUM].value = Hum;
@@ -1744,32 +2618,57 @@ void PSpower::TimerHit()
 
     if (!isConnected())
         return;
+    
+    PS_TRACE_SPAN("TimerHit");
+    
+    // a burst has the hub to itself, normal polling waits for it
+    if (burst.isActive()) {
+        if (burst.isDone())
+            finishBurst();
+        SetTimer(POLLMS);
+        return;
+    }
 
+    struct timespec tickStart;
+    clock_gettime(CLOCK_MONOTONIC, &tickStart);
+    poll.begin(tickStart);
+    
     psctl.getStatus();
     
+    struct timespec now, mono;
+    clock_gettime(CLOCK_REALTIME, &now);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    history.addSample(now.tv_sec, psctl.chanValue);
+    energy.sample(mono, psctl.chanValue);
+    
+    if (journal.isOpen() && !journal.append(int64_t(now.tv_sec) * 1000 + now.tv_nsec / 1000000, psctl.chanRaw)) {
+        LOG_ERROR("Telemetry journal stopped, unable to start a new segment");
+        journal.close();
+        IUResetSwitch(&JournalSP);
+        JournalS[JOURNAL_OFF].s = ISS_ON;
+        JournalSP.s = IPS_ALERT;
+        IDSetSwitch(&JournalSP, nullptr);
+    }
+    
+    if (exporter.isOpen() && !exporter.append(int64_t(now.tv_sec) * 1000 + now.tv_nsec / 1000000, psctl.chanRaw)) {
+        LOG_ERROR("Telemetry export stopped, unable to write a block");
+        exporter.close();
+        IUResetSwitch(&ExportSP);
+        ExportS[EXPORT_OFF].s = ISS_ON;
+        ExportSP.s = IPS_ALERT;
+        IDSetSwitch(&ExportSP, nullptr);
+    }
+    
     PSpower::updateWeather();
     
     /***************************/
     /**  handle focus update  **/
     /***************************/
-    if (psctl.getAbsPosition(&currentTicks))
-        FocusAbsPosN[0].value = currentTicks;
-    
-    m_Motor = static_cast<PS_MOTOR>(psctl.getFocusStatus());
-    if (FocusAbsPosNP.s == IPS_BUSY || FocusRelPosNP.s == IPS_BUSY) {
-        if (m_Motor == PS_NOT_MOVING && targetPosition == FocusAbsPosN[0].value) {
-            if (FocusRelPosNP.s == IPS_BUSY) {
-                FocusRelPosNP.s = IPS_OK;
-                IDSetNumber(&FocusRelPosNP, nullptr);
-            }
-
-            FocusAbsPosNP.s = IPS_OK;
-            LOGF_INFO("Focuser now at %d", targetPosition);
-            LOG_DEBUG("Focuser reached target position.");
-        }
-        
-        IDSetNumber(&FocusAbsPosNP, nullptr);
-    }
+    // while tracking, the move is followed by trackFocus()
+    if (trackTimer == -1)
+        updateFocus();
+    checkFocusLog();
+    compensateTemp();
     
     /**************************************/
     //Update sensor data (volts/amps/watts)
@@ -1777,20 +2676,33 @@ void PSpower::TimerHit()
     VoltsIn = psctl.statusMap["IN"].levels;
     AmpsIn = psctl.statusMap["IN"].current;
     
-    AmpHrs += (AmpsIn * POLLMS)/(60*60*1000.0);
-    WattHrs += (VoltsIn * AmpsIn * POLLMS)/(60*60*1000.0);
-    
     PowerSensorsN[SENSOR_VOLTAGE].value = VoltsIn;
     PowerSensorsN[SENSOR_CURRENT].value = AmpsIn;
     PowerSensorsN[SENSOR_POWER].value = (VoltsIn * AmpsIn);
-    PowerSensorsN[SENSOR_AMP_HOURS].value = AmpHrs;
-    PowerSensorsN[SENSOR_WATT_HOURS].value = WattHrs;
+    publishEnergy();
     IDSetNumber(&PowerSensorsNP, nullptr);
     
+    // keep the totals across a crash or power loss
+    if (now.tv_sec - lastEnergySave >= 300) {
+        saveConfig(true, EnergyNP.name);
+        lastEnergySave = now.tv_sec;
+    }
+    
+    // command statistics change slowly, no need to send them every tick
+    if (now.tv_sec - lastDiag >= 10) {
+        publishDiag();
+        publishPoll();
+        IDSetNumber(&DiagCountsNP, nullptr);
+        IDSetText(&DiagLatencyTP, nullptr);
+        IDSetNumber(&PollStatsNP, nullptr);
+        lastDiag = now.tv_sec;
+    }
+    
     /**************************************/
     // Set status according to faults
     /**************************************/
-    if (!PSpower::checkFaults())
+    lastFaults = PSpower::checkFaults();
+    if (!lastFaults)
         PowerSensorsNP.s = IPS_OK;
     else
         PowerSensorsNP.s = IPS_ALERT;
@@ -1877,7 +2789,7 @@ void PSpower::TimerHit()
         perpwr = 0;
     
     if (AutoDewS[DEW1].s == ISS_ON) {
-        psctl.setDew(DEW1, uint8_t(perpwr));
+        psctl.setDew(DEW1, uint8_t(perpwr), false);
         DEWpercentN[DEW1].value = psctl.statusMap["Dew1"].setting;
         IDSetNumber(&DEWpercentNP, nullptr);
         if (perpwr != lastDew1PerPwr) {
@@ -1887,7 +2799,7 @@ void PSpower::TimerHit()
     }
     
     if (AutoDewS[DEW2].s == ISS_ON) {
-        psctl.setDew(DEW2, uint8_t(perpwr));
+        psctl.setDew(DEW2, uint8_t(perpwr), false);
         DEWpercentN[DEW2].value = psctl.statusMap["Dew2"].setting;
         IDSetNumber(&DEWpercentNP, nullptr);
         if (perpwr != lastDew2PerPwr) {
@@ -1898,7 +2810,7 @@ void PSpower::TimerHit()
     
     /**  TODO MP is different, needs additional tests
     if (AutoDewS[MPdew].s == ISS_ON) {
-        psctl.setDew(MP, uint8_t(perpwr));
+        psctl.setDew(MP, uint8_t(perpwr), false);
         DEWpercentN[MPdew].value = psctl.statusMap["MP"].setting;
         IDSetNumber(&DEWpercentNP, nullptr);
     }
@@ -1931,7 +2843,25 @@ void PSpower::TimerHit()
     **/
     //TODO set MP rate and dew fields and var volts fields and correct MP type switch and autoboot switches (or do this during init)
     
-    SetTimer(POLLMS);
+    struct timespec tickEnd;
+    clock_gettime(CLOCK_MONOTONIC, &tickEnd);
+    poll.end(tickEnd);
+    lastTickSec = poll.tickMs / 1000.0;
+    tickCount++;
+    
+    if (metrics.isOpen() && now.tv_sec - lastMetrics >= MetricsPeriodN[0].value) {
+        publishMetrics(true);
+        lastMetrics = now.tv_sec;
+    }
+    
+    // next tick one period after this one started, not after it finished
+    double load = -1;
+    if (getloadavg(&load, 1) == 1)
+        load /= sysconf(_SC_NPROCESSORS_ONLN);
+    bool moving = FocusAbsPosNP.s == IPS_BUSY || FocusRelPosNP.s == IPS_BUSY;
+    uint32_t delay = poll.next(moving, load);
+    POLLMS = poll.targetMs;
+    SetTimer(delay);
 }
 
 /**********************************************************/
@@ -1940,11 +2870,32 @@ void PSpower::TimerHit()
 /**********************************************************/
 IPState PSpower::MoveAbsFocuser(uint32_t targetTicks)
 {
+    clock_gettime(CLOCK_MONOTONIC, &moveStart);
+    
     if ( ! psctl.MoveAbsFocuser(targetTicks))
         return IPS_ALERT;
 
+    // anything but a compensation move sets a new focus to compensate from
+    if (!tcMoving)
+        tcomp.unanchor();
+    
+    if (!queueMoving && FocusQueueNP.s == IPS_BUSY)
+        cancelQueue("Focus queue cancelled by a new move");
+    
+    moveFrom = FocusAbsPosN[0].value;
     targetPosition = targetTicks;
     FocusAbsPosNP.s = IPS_BUSY;
+    focusSentMs = 0;
+    
+    motion.setProfile(curProfile.stepPeriod, curProfile.backlash, curProfile.prefDir);
+    FocusEtaN[ETA_TOTAL].value = motion.predict(moveFrom, targetTicks) / 1000.0;
+    FocusEtaN[ETA_REMAINING].value = FocusEtaN[ETA_TOTAL].value;
+    FocusEtaNP.s = IPS_BUSY;
+    IDSetNumber(&FocusEtaNP, nullptr);
+    
+    // a new target mid-move starts the prediction over
+    stopTracking();
+    startTracking();
     
     LOGF_INFO("Set abs position to %d", targetTicks);
 
@@ -1958,6 +2909,14 @@ IPState PSpower::MoveRelFocuser(FocusDirection dir, uint32_t ticks)
     int reversed = (FocusReverseS[INDI_ENABLED].s == ISS_ON) ? -1 : 1;
     int relative = static_cast<int>(ticks);
 
+    // The position shown can be a poll old (or the move model's estimate)
+    // and the hub's temperature compensation may have moved since, start
+    // from the live position.  The hub has no relative move, PS_IN/PS_OUT
+    // run to the ends.
+    uint32_t from;
+    if (psctl.getAbsPosition(&from))
+        FocusAbsPosN[0].value = from;
+
     int targetAbsPosition = FocusAbsPosN[0].value + (relative * direction * reversed);
 
     targetAbsPosition = std::min(static_cast<uint32_t>(FocusMaxPosN[0].value),static_cast<uint32_t>(std::max(static_cast<int>(FocusAbsPosN[0].min), targetAbsPosition)));
@@ -1965,13 +2924,191 @@ IPState PSpower::MoveRelFocuser(FocusDirection dir, uint32_t ticks)
     return MoveAbsFocuser(targetAbsPosition);
 }
 
+//************************************************************
+// Read the motor state and position, finish the move once the motor
+// stopped at the target.  Returns true while a move is still active.
+bool PSpower::updateFocus()
+{
+    // status first, a stopped motor's position is final
+    m_Motor = static_cast<PS_MOTOR>(psctl.getFocusStatus());
+    if (psctl.getAbsPosition(&currentTicks))
+        FocusAbsPosN[0].value = currentTicks;
+    
+    if (FocusAbsPosNP.s != IPS_BUSY && FocusRelPosNP.s != IPS_BUSY)
+        return false;
+    
+    // with the hub's temperature compensation on, it may already have
+    // moved on from the target by the time the stop is seen, but by no
+    // more than one hysteresis worth of steps
+    bool atTarget = targetPosition == FocusAbsPosN[0].value;
+    if (m_Motor == PS_NOT_MOVING && !atTarget && moveElapsedMs() > FocusEtaN[ETA_TOTAL].value * 1000) {
+        double slack = curProfile.tempSensor != 0 ? ceil(fabs(curProfile.tempCoef * curProfile.tempHysterisis)) : 0;
+        atTarget = fabs(FocusAbsPosN[0].value - targetPosition) <= slack;
+        
+        if (!atTarget) {
+            LOGF_ERROR("Focuser stopped at %.0f, %u was the target", FocusAbsPosN[0].value, targetPosition);
+            if (FocusQueueNP.s == IPS_BUSY)
+                cancelQueue("Focus queue stopped, the focuser missed its target");
+            if (FocusRelPosNP.s == IPS_BUSY) {
+                FocusRelPosNP.s = IPS_ALERT;
+                IDSetNumber(&FocusRelPosNP, nullptr);
+            }
+            FocusAbsPosNP.s = IPS_ALERT;
+        }
+    }
+    
+    if (m_Motor == PS_NOT_MOVING && atTarget) {
+        // a queued sweep goes straight on to its next leg
+        if (nextQueueLeg())
+            return true;
+        
+        if (FocusRelPosNP.s == IPS_BUSY) {
+            FocusRelPosNP.s = IPS_OK;
+            IDSetNumber(&FocusRelPosNP, nullptr);
+        }
+
+        FocusAbsPosNP.s = IPS_OK;
+        LOGF_INFO("Focuser now at %d", targetPosition);
+        LOG_DEBUG("Focuser reached target position.");
+    }
+    
+    bool busy = FocusAbsPosNP.s == IPS_BUSY;
+    if (busy) {
+        double left = FocusEtaN[ETA_TOTAL].value - moveElapsedMs() / 1000.0;
+        FocusEtaN[ETA_REMAINING].value = left > 0 ? left : 0;
+    }
+    else {
+        FocusEtaN[ETA_REMAINING].value = 0;
+        FocusEtaNP.s = IPS_OK;
+    }
+    publishFocus(!busy);
+    
+    return busy;
+}
+
+//************************************************************
+// Send the position and ETA to clients, no more than 'Client rate'
+// times a second while moving (0: every read).  The arrival is always
+// sent.
+void PSpower::publishFocus(bool final)
+{
+    double hz = FocusTrackN[TRACK_CLIENT_HZ].value;
+    double elapsed = moveElapsedMs();
+    
+    if (!final && hz > 0 && elapsed - focusSentMs < 1000.0 / hz)
+        return;
+    
+    focusSentMs = elapsed;
+    IDSetNumber(&FocusAbsPosNP, nullptr);
+    IDSetNumber(&FocusEtaNP, nullptr);
+}
+
+//************************************************************
+double PSpower::moveElapsedMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - moveStart.tv_sec) * 1000.0 + (now.tv_nsec - moveStart.tv_nsec) / 1e6;
+}
+
+//************************************************************
+// Sleep through most of the predicted move, then poll only the focuser
+// at the tracking period until it is done.  While asleep, clients get
+// the position the model expects at the client rate, no USB involved.
+// TimerHit leaves the focuser alone meanwhile.
+void PSpower::startTracking()
+{
+    if (FocusTrackS[TRACK_ON].s != ISS_ON || trackTimer != -1)
+        return;
+    
+    // wake two polls plus 10% ahead of the ETA, the model may be off
+    double period = FocusTrackN[TRACK_PERIOD].value;
+    double sleep = FocusEtaN[ETA_TOTAL].value * 1000.0 * 0.9 - 2 * period;
+    if (sleep < period)
+        sleep = period;
+    
+    trackSawMoving = false;
+    trackWakeMs = sleep;
+    
+    double hz = FocusTrackN[TRACK_CLIENT_HZ].value;
+    if (hz > 0 && sleep > 1000.0 / hz)
+        sleep = 1000.0 / hz;
+    trackTimer = IEAddTimer(int(sleep), trackFocusHelper, this);
+}
+
+//************************************************************
+void PSpower::stopTracking()
+{
+    if (trackTimer == -1)
+        return;
+    
+    IERmTimer(trackTimer);
+    trackTimer = -1;
+}
+
+//************************************************************
+void PSpower::trackFocusHelper(void *self)
+{
+    static_cast<PSpower *>(self)->trackFocus();
+}
+
+//************************************************************
+void PSpower::trackFocus()
+{
+    // the timer is spent, back to TimerHit unless it goes again
+    trackTimer = -1;
+    
+    if (!isConnected() || burst.isActive())
+        return;
+    
+    PS_TRACE_SPAN("trackFocus");
+    double period = FocusTrackN[TRACK_PERIOD].value;
+    double elapsed = moveElapsedMs();
+    
+    // still in the predicted part of the move
+    if (elapsed < trackWakeMs) {
+        FocusAbsPosN[0].value = motion.positionAt(moveFrom, targetPosition, elapsed);
+        FocusEtaN[ETA_REMAINING].value = std::max(0.0, FocusEtaN[ETA_TOTAL].value - elapsed / 1000.0);
+        publishFocus(false);
+        
+        double sleep = std::min(trackWakeMs - elapsed, 1000.0 / FocusTrackN[TRACK_CLIENT_HZ].value);
+        trackTimer = IEAddTimer(std::max(1, int(sleep)), trackFocusHelper, this);
+        return;
+    }
+    
+    if (updateFocus()) {
+        // a queued leg started from updateFocus has a timer of its own
+        if (trackTimer == -1) {
+            trackSawMoving = true;
+            trackTimer = IEAddTimer(period, trackFocusHelper, this);
+        }
+        return;
+    }
+    
+    // it stopped since the last poll, or earlier if this is the first look
+    if (FocusAbsPosNP.s == IPS_OK)
+        motion.observe(moveFrom, targetPosition, trackSawMoving ? elapsed - period / 2 : elapsed);
+}
+
 //************************************************************
 bool PSpower::AbortFocuser()
 {
     LOG_INFO("Aborting Focus");
     FocusAbsPosNP.s = IPS_OK;
     
-    return psctl.AbortFocuser();
+    // an aborted move says nothing about move times
+    stopTracking();
+    if (FocusQueueNP.s == IPS_BUSY)
+        cancelQueue("Focus queue aborted");
+    FocusEtaN[ETA_REMAINING].value = 0;
+    FocusEtaNP.s = IPS_IDLE;
+    IDSetNumber(&FocusEtaNP, nullptr);
+    
+    // the position shown may be the model's, replace it with the real one
+    bool ok = psctl.AbortFocuser();
+    if (psctl.getAbsPosition(&currentTicks))
+        FocusAbsPosN[0].value = currentTicks;
+    return ok;
 }
 
 //************************************************************
@@ -1982,11 +3119,300 @@ bool PSpower::SyncFocuser(uint32_t ticks)
 
     targetPosition = ticks;
     FocusAbsPosNP.s = IPS_OK;
+    tcomp.unanchor();
     LOGF_INFO("Set abs position to %d", ticks);
 
     return psctl.SyncFocuser(ticks);
 }
 
+//************************************************************
+// Parse FOCUS_QUEUE and start its first leg
+bool PSpower::startQueue()
+{
+    if (FocusAbsPosNP.s == IPS_BUSY || FocusRelPosNP.s == IPS_BUSY) {
+        LOG_WARN("Focus queue not started, the focuser is moving");
+        return false;
+    }
+    
+    queueTargets.clear();
+    const char *p = FocusQueueT[0].text;
+    while (*p) {
+        if (strchr(" ,;\t\n", *p)) {
+            p++;
+            continue;
+        }
+        char *end;
+        unsigned long to = strtoul(p, &end, 10);
+        if (end == p || to > FocusMaxPosN[0].value) {
+            LOGF_ERROR("Focus queue: bad target at '%.20s'", p);
+            return false;
+        }
+        if (queueTargets.size() == PS_QUEUE_MAX) {
+            LOGF_ERROR("Focus queue holds at most %d targets", PS_QUEUE_MAX);
+            return false;
+        }
+        queueTargets.push_back(to);
+        p = end;
+    }
+    if (queueTargets.empty())
+        return false;
+    
+    queue.load(queueTargets, FocusAbsPosN[0].value, FocusQueueSetN[0].value, curProfile.prefDir, FocusMaxPosN[0].value);
+    queueStepMs = 0;
+    FocusQueueN[QUEUE_REACHED].value = 0;
+    FocusQueueN[QUEUE_TARGETS].value = queue.targets;
+    FocusQueueNP.s = IPS_BUSY;
+    IDSetNumber(&FocusQueueNP, nullptr);
+    LOGF_INFO("Focus queue of %u targets", queue.targets);
+    
+    if (!nextQueueLeg()) {
+        cancelQueue("Focus queue could not start");
+        return false;
+    }
+    return true;
+}
+
+//************************************************************
+// The current leg (if any) arrived, report it if it was a target and
+// start the next one.  False once the sweep is over.
+bool PSpower::nextQueueLeg()
+{
+    if (FocusQueueNP.s != IPS_BUSY)
+        return false;
+    
+    if (FocusAbsPosNP.s == IPS_BUSY) {
+        queueStepMs += moveElapsedMs();
+        if (legArrival) {
+            queue.reached++;
+            FocusQueueN[QUEUE_REACHED].value = queue.reached;
+            FocusQueueN[QUEUE_POSITION].value = FocusAbsPosN[0].value;
+            FocusQueueN[QUEUE_STEP_MS].value = queueStepMs;
+            queueStepMs = 0;
+            if (!queue.active())
+                FocusQueueNP.s = IPS_OK;
+            IDSetNumber(&FocusQueueNP, nullptr);
+        }
+    }
+    
+    uint32_t to;
+    if (!queue.pop(&to, &legArrival)) {
+        FocusQueueNP.s = IPS_OK;
+        FocusQueueTP.s = IPS_OK;
+        IDSetText(&FocusQueueTP, nullptr);
+        return false;
+    }
+    
+    queueMoving = true;
+    FocusAbsPosNP.s = MoveAbsFocuser(to);
+    queueMoving = false;
+    
+    if (FocusAbsPosNP.s != IPS_BUSY) {
+        cancelQueue("Focus queue stopped, the move failed");
+        return false;
+    }
+    return true;
+}
+
+//************************************************************
+void PSpower::cancelQueue(const char *why)
+{
+    LOG_WARN(why);
+    queue.clear();
+    FocusQueueNP.s = IPS_ALERT;
+    IDSetNumber(&FocusQueueNP, nullptr);
+    FocusQueueTP.s = IPS_ALERT;
+    IDSetText(&FocusQueueTP, nullptr);
+}
+
+//************************************************************
+// Follow the camera's exposures, compensation moves only happen between
+// them, and the filter wheel's filter, for the focus log
+bool PSpower::ISSnoopDevice(XMLEle *root)
+{
+    const char *dev = findXMLAttValu(root, "device");
+    const char *prop = findXMLAttValu(root, "name");
+    IPState state;
+    
+    if (ActiveDevicesT[SNOOP_CCD].text[0] && strcmp(dev, ActiveDevicesT[SNOOP_CCD].text) == 0 && strcmp(prop, "CCD_EXPOSURE") == 0 &&
+        crackIPState(findXMLAttValu(root, "state"), &state) == 0)
+        ccdBusy = state == IPS_BUSY;
+    
+    if (ActiveDevicesT[SNOOP_FILTER].text[0] && strcmp(dev, ActiveDevicesT[SNOOP_FILTER].text) == 0)
+        snoopFilter(root, prop);
+    
+    return DefaultDevice::ISSnoopDevice(root);
+}
+
+//************************************************************
+string PSpower::tcompPath()
+{
+    return string(JournalDirT[0].text) + "/tcomp.txt";
+}
+
+//************************************************************
+// Called every poll.  Moves the focuser by what the model says the
+// temperature change since the last focus is worth, in steps of at most
+// 'Max move', no more often than 'Min interval', and only when that is
+// at least 'Hysteresis' and the snooped camera isn't exposing.  Without
+// a camera to snoop nothing moves, a move could land mid exposure.
+void PSpower::compensateTemp()
+{
+    if (TcompS[TC_ON].s != ISS_ON || !tcomp.valid() || curProfile.tempSensor != 0)
+        return;
+    if (FocusAbsPosNP.s == IPS_BUSY || FocusRelPosNP.s == IPS_BUSY)
+        return;
+    
+    double t = tempC();
+    uint32_t pos = FocusAbsPosN[0].value;
+    
+    // first look at rest after someone else's move
+    if (!tcomp.isAnchored()) {
+        tcomp.anchor(t, pos);
+        LOGF_DEBUG("Temperature compensation from %u at %.1f C", pos, t);
+    }
+    
+    // the offset shown follows the temperature
+    if (lround(tcomp.predict(t) - tcomp.predict(tcomp.anchorTemp())) != TcompModelN[TC_OFFSET].value)
+        publishTcomp();
+    
+    if (ccdBusy || !ActiveDevicesT[SNOOP_CCD].text[0])
+        return;
+    
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int32_t steps = tcomp.correction(t, pos, now.tv_sec + now.tv_nsec / 1e9);
+    if (steps == 0)
+        return;
+    
+    int64_t target = int64_t(pos) + steps;
+    target = std::max<int64_t>(FocusAbsPosN[0].min, std::min<int64_t>(FocusMaxPosN[0].value, target));
+    if (target == pos)
+        return;
+    
+    LOGF_INFO("Temperature compensation: %.1f C, moving %+d steps", t, int(target - pos));
+    tcMoving = true;
+    FocusAbsPosNP.s = MoveAbsFocuser(target);
+    tcMoving = false;
+    IDSetNumber(&FocusAbsPosNP, nullptr);
+}
+
+//************************************************************
+void PSpower::publishTcomp()
+{
+    double t = tempC();
+    TcompModelN[TC_POINTS].value = tcomp.points;
+    TcompModelN[TC_ORDER].value = tcomp.order;
+    TcompModelN[TC_SLOPE].value = tcomp.valid() ? tcomp.slope(t) : 0;
+    TcompModelN[TC_OFFSET].value = tcomp.valid() && tcomp.isAnchored() ? lround(tcomp.predict(t) - tcomp.predict(tcomp.anchorTemp())) : 0;
+    TcompModelNP.s = tcomp.valid() ? IPS_OK : IPS_IDLE;
+    IDSetNumber(&TcompModelNP, nullptr);
+}
+
+//************************************************************
+string PSpower::focusLogPath()
+{
+    return string(JournalDirT[0].text) + "/focuslog.bin";
+}
+
+//************************************************************
+// FILTER_SLOT (1 based) and FILTER_NAME of the snooped wheel.  The slot
+// counts once the wheel reports it has arrived; a different filter than
+// before asks for a jump to its focus.
+void PSpower::snoopFilter(XMLEle *root, const char *prop)
+{
+    IPState state;
+    
+    if (strcmp(prop, "FILTER_NAME") == 0) {
+        filterNames.clear();
+        for (XMLEle *ep = nextXMLEle(root, 1); ep; ep = nextXMLEle(root, 0))
+            filterNames.push_back(pcdataXMLEle(ep));
+    }
+    else if (strcmp(prop, "FILTER_SLOT") == 0) {
+        if (crackIPState(findXMLAttValu(root, "state"), &state) != 0 || state != IPS_OK)
+            return;
+        XMLEle *ep = nextXMLEle(root, 1);
+        if (!ep)
+            return;
+        filterSlot = atoi(pcdataXMLEle(ep));
+    }
+    else
+        return;
+    
+    if (filterSlot < 1)
+        return;
+    
+    string name = filterSlot <= int(filterNames.size()) ? filterNames[filterSlot - 1] : "Slot " + to_string(filterSlot);
+    if (name == filterName)
+        return;
+    
+    LOGF_DEBUG("Filter %s", name.c_str());
+    // the first report is where the session starts, not a change
+    if (!filterName.empty())
+        logJumpPending = true;
+    filterName = name;
+    logPredTemp = -273;
+}
+
+//************************************************************
+// Called every poll.  Keeps the prediction shown current and makes a
+// pending jump once the focuser and camera are idle and the wheel, if
+// there is one, has said which filter is in.
+void PSpower::checkFocusLog()
+{
+    // tempC() is the sensor's 8.8 reading, it moves in 1/256 C
+    if (fabs(tempC() - logPredTemp) >= PS_FOCUSLOG_REDO)
+        publishFocusLog();
+    
+    if (!logJumpPending || FocusLogJumpS[LOG_JUMP_AUTO].s != ISS_ON) {
+        logJumpPending = false;
+        return;
+    }
+    if (ccdBusy || (ActiveDevicesT[SNOOP_FILTER].text[0] && filterName.empty()))
+        return;
+    if (FocusAbsPosNP.s == IPS_BUSY || FocusRelPosNP.s == IPS_BUSY)
+        return;
+    
+    logJumpPending = false;
+    jumpToPredicted(filterName.empty() ? "Session start" : filterName.c_str());
+}
+
+//************************************************************
+bool PSpower::jumpToPredicted(const char *why)
+{
+    uint32_t pos;
+    float dT;
+    
+    if (FocusAbsPosNP.s == IPS_BUSY || FocusRelPosNP.s == IPS_BUSY) {
+        LOG_WARN("Focuser is moving, no jump to the predicted focus");
+        return false;
+    }
+    if (!focusLog.predict(filterName.c_str(), tempC(), &pos, &dT)) {
+        LOG_INFO("No focus log entries to predict from");
+        return false;
+    }
+    
+    pos = std::min<uint32_t>(pos, FocusMaxPosN[0].value);
+    LOGF_INFO("%s: moving to predicted focus %u (log entries within %.1f C)", why, pos, dT);
+    FocusAbsPosNP.s = MoveAbsFocuser(pos);
+    IDSetNumber(&FocusAbsPosNP, nullptr);
+    return FocusAbsPosNP.s != IPS_ALERT;
+}
+
+//************************************************************
+void PSpower::publishFocusLog()
+{
+    uint32_t pos = 0;
+    float dT = 0;
+    bool ok = focusLog.predict(filterName.c_str(), tempC(), &pos, &dT);
+    
+    logPredTemp = tempC();
+    FocusLogPredN[LOG_ENTRIES].value = focusLog.size();
+    FocusLogPredN[LOG_PREDICTED].value = ok ? pos : 0;
+    FocusLogPredN[LOG_NEAREST_DT].value = ok ? dT : 0;
+    FocusLogPredNP.s = ok ? IPS_OK : IPS_IDLE;
+    IDSetNumber(&FocusLogPredNP, nullptr);
+}
+
 //************************************************************
 // Called by FI
 bool PSpower::SetFocuserMaxPosition(uint32_t ticks)
@@ -1995,6 +3421,206 @@ bool PSpower::SetFocuserMaxPosition(uint32_t ticks)
     return psctl.SetFocuserMaxPosition(ticks);
 }
 
+/**********************************************************/
+/*   Telemetry History                                    */
+/**********************************************************/
+/**********************************************************/
+bool PSpower::queryHistory()
+{
+    uint8_t channel = psFindChannel(HistoryQueryT[HIST_CHANNEL].text);
+    if (channel == PS_CH_N) {
+        LOGF_ERROR("Unknown history channel %s", HistoryQueryT[HIST_CHANNEL].text);
+        return false;
+    }
+    
+    uint8_t res = PSHistory::PS_RES_N;   // auto
+    if (strcmp(HistoryQueryT[HIST_RES].text, "1s") == 0)
+        res = PSHistory::PS_RES_1S;
+    else if (strcmp(HistoryQueryT[HIST_RES].text, "1m") == 0)
+        res = PSHistory::PS_RES_1M;
+    else if (strcmp(HistoryQueryT[HIST_RES].text, "10m") == 0)
+        res = PSHistory::PS_RES_10M;
+    
+    // values <= 0 are relative to now
+    time_t now = time(nullptr);
+    time_t from = atol(HistoryQueryT[HIST_FROM].text);
+    time_t to = atol(HistoryQueryT[HIST_TO].text);
+    if (from <= 0)
+        from += now;
+    if (to <= 0)
+        to += now;
+    
+    size_t len = history.query(channel, res, from, to, historyBuf.data(), historyBuf.size());
+    
+    HistoryB[0].blob = historyBuf.data();
+    HistoryB[0].bloblen = HistoryB[0].size = len;
+    HistoryBP.s = IPS_OK;
+    IDSetBLOB(&HistoryBP, nullptr);
+    
+    return true;
+}
+
+/**********************************************************/
+/*   Energy                                               */
+/**********************************************************/
+/**********************************************************/
+void PSpower::publishEnergy()
+{
+    for (int p = 0; p < PSEnergy::PS_E_N; p++) {
+        EnergyN[p * 2].value = energy.ampHrs[p];
+        EnergyN[p * 2 + 1].value = energy.wattHrs[p];
+    }
+    EnergyNP.s = IPS_OK;
+    IDSetNumber(&EnergyNP, nullptr);
+    
+    // the main tab totals are the input's
+    PowerSensorsN[SENSOR_AMP_HOURS].value = energy.ampHrs[PSEnergy::PS_E_IN];
+    PowerSensorsN[SENSOR_WATT_HOURS].value = energy.wattHrs[PSEnergy::PS_E_IN];
+}
+
+/**********************************************************/
+/*   Diagnostics and Metrics                              */
+/**********************************************************/
+/**********************************************************/
+// Copy the PSdiag statistics into the Diagnostics properties, callers IDSet them
+void PSpower::publishDiag()
+{
+    psDiagSummary all = psDiag().total();
+    
+    DiagCountsN[DIAG_CALLS].value = all.calls;
+    DiagCountsN[DIAG_TIMEOUTS].value = all.timeouts;
+    DiagCountsN[DIAG_RETRIES].value = all.retries;
+    DiagCountsN[DIAG_ERRORS].value = all.errors;
+    DiagCountsN[DIAG_P50].value = all.p50 / 1000.0;
+    DiagCountsN[DIAG_P95].value = all.p95 / 1000.0;
+    DiagCountsN[DIAG_P99].value = all.p99 / 1000.0;
+    DiagCountsN[DIAG_MAX].value = all.max / 1000.0;
+    DiagCountsNP.s = (all.timeouts || all.errors) ? IPS_ALERT : IPS_OK;
+    
+    for (int i = 0; i < PS_DIAG_SHOWN; i++)
+    {
+        psDiagSummary d = psDiag().summary(psDiagShown[i]);
+        char *line = DiagLatencyT[i].text;
+        
+        if (d.calls == 0)
+            line[0] = 0;
+        else
+            snprintf(line, DIAG_LINE, "p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms  (%lu calls, %lu timeouts, %lu retries, %lu errors)",
+                     d.p50 / 1000.0, d.p95 / 1000.0, d.p99 / 1000.0, d.max / 1000.0,
+                     (unsigned long)d.calls, (unsigned long)d.timeouts, (unsigned long)d.retries, (unsigned long)d.errors);
+    }
+    DiagLatencyTP.s = IPS_OK;
+}
+
+/**********************************************************/
+/**********************************************************/
+// Copy the PSPoll timings into PollStatsNP, callers IDSet it
+void PSpower::publishPoll()
+{
+    PollStatsN[POLL_TICK].value = poll.tickMs;
+    PollStatsN[POLL_TICK_AVG].value = poll.avgTickMs;
+    PollStatsN[POLL_ACTUAL].value = poll.periodMs;
+    PollStatsN[POLL_JITTER].value = poll.jitterMs;
+    PollStatsN[POLL_TARGET].value = poll.targetMs;
+    PollStatsN[POLL_OVERRUNS].value = poll.overruns;
+    PollStatsNP.s = poll.overruns ? IPS_BUSY : IPS_OK;
+}
+
+/**********************************************************/
+/**********************************************************/
+// Open the exporter in the mode MetricsSP selects
+bool PSpower::startMetrics()
+{
+    stopMetrics();
+    
+    if (IUFindOnSwitchIndex(&MetricsSP) == METRICS_FILE) {
+        const char *path = MetricsPathT[METRICS_FILE_PATH].text;
+        if (!metrics.openFile(path) || !metrics.update(psMetricsSample { false, psctl.chanValue, psctl.chanRaw, energy.ampHrs, energy.wattHrs, 0, 0, 0, 0, 0, 0 })) {
+            LOGF_ERROR("Unable to write metrics to %s", path);
+            metrics.close();
+            return false;
+        }
+        LOGF_INFO("Writing metrics to %s", path);
+    }
+    else {
+        const char *path = MetricsPathT[METRICS_SOCKET_PATH].text;
+        if (!metrics.openSocket(path)) {
+            LOGF_ERROR("Unable to serve metrics on %s", path);
+            return false;
+        }
+        metricsCallback = IEAddCallback(metrics.socketFd(), serveMetrics, this);
+        LOGF_INFO("Serving metrics on %s", path);
+    }
+    
+    lastMetrics = 0;
+    return true;
+}
+
+/**********************************************************/
+/**********************************************************/
+void PSpower::stopMetrics()
+{
+    if (metricsCallback >= 0) {
+        IERmCallback(metricsCallback);
+        metricsCallback = -1;
+    }
+    metrics.close();
+}
+
+/**********************************************************/
+/**********************************************************/
+// Refresh the exporter from the last poll
+void PSpower::publishMetrics(bool up)
+{
+    if (!metrics.isOpen())
+        return;
+    
+    psMetricsSample sample { up, psctl.chanValue, psctl.chanRaw, energy.ampHrs, energy.wattHrs,
+                             lastFaults, currentTicks, lastTickSec, poll.periodMs / 1000.0, poll.jitterMs / 1000.0, tickCount };
+    if (!metrics.update(sample))
+        LOG_DEBUG("Unable to write the metrics file");
+}
+
+/**********************************************************/
+/**********************************************************/
+// INDI event loop callback, a scraper connected to the metrics socket
+void PSpower::serveMetrics(int fd, void *self)
+{
+    static_cast<PSpower *>(self)->metrics.serve();
+}
+
+/**********************************************************/
+/*   Burst Capture                                        */
+/**********************************************************/
+/**********************************************************/
+void PSpower::finishBurst()
+{
+    burst.finish();
+    
+    BurstStatsN[BURST_PEAK].value = burst.peak;
+    BurstStatsN[BURST_RMS].value = burst.rms;
+    BurstStatsN[BURST_OVER].value = burst.overSec;
+    BurstStatsN[BURST_SAMPLES].value = burst.samples;
+    BurstStatsN[BURST_RATE].value = burst.rate;
+    BurstStatsNP.s = burst.samples ? IPS_OK : IPS_ALERT;
+    IDSetNumber(&BurstStatsNP, nullptr);
+    
+    BurstB[0].blob = const_cast<char *>(burst.csv());
+    BurstB[0].bloblen = BurstB[0].size = burst.csvLen;
+    BurstBP.s = IPS_OK;
+    IDSetBLOB(&BurstBP, nullptr);
+    
+    BurstS[0].s = ISS_OFF;
+    BurstSP.s = burst.samples ? IPS_OK : IPS_ALERT;
+    IDSetSwitch(&BurstSP, nullptr);
+    
+    if (burst.samples)
+        LOGF_INFO("Burst of %s: %u samples at %.0f Hz, peak %.3f %s", psChannels[burst.channel].name,
+                  burst.samples, burst.rate, burst.peak, psChannels[burst.channel].unit);
+    else
+        LOG_ERROR("Burst capture read no samples");
+}
+
 /**********************************************************/
 /*   Handle Faults                                        */
 /**********************************************************/
@@ -14,6 +14,16 @@
 #include "indiweatherinterface.h"
 #include <cstring>
 #include "PScontrol.h"
+#include "PShistory.h"
+#include "PSjournal.h"
+#include "PSexport.h"
+#include "PSburst.h"
+#include "PSenergy.h"
+#include "PSmetrics.h"
+#include "PSpoll.h"
+#include "PSmotion.h"
+#include "PStempcomp.h"
+#include "PSfocuslog.h"
 
 using namespace std;
 
@@ -39,6 +49,7 @@ public:
     virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
     virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
     virtual bool ISNewNumber(const char * dev, const char * name, double values[], char * names[], int n) override;
+    virtual bool ISSnoopDevice(XMLEle *root) override;
     virtual void ISGetProperties(const char *dev) override;
     virtual bool updateProperties() override;
     virtual void TimerHit() override;
@@ -54,6 +65,8 @@ public:
     virtual bool SetFocuserMaxPosition(uint32_t ticks) override;
     
 private:
+    friend class PSBench;       // powerstar_bench.cpp
+
     virtual bool saveConfigItems(FILE *fp) override;
     
     bool setAbsPosition(uint32_t ticks);
@@ -63,19 +76,24 @@ private:
     bool setPosition(uint32_t ticks, uint8_t cmdCode);
     bool getPosition(uint32_t *ticks, uint8_t cmdCode);
     uint32_t checkFaults();
+    void readHub();
+    bool queryHistory();
+    void finishBurst();
     float lastTemp = 0;
     float lastHum = 0;
     float lastDpDep = 0;
     bool critWeather = false;
     
+    // WI parameters, found once so a tick doesn't build their names
+    enum { WP_TEMP, WP_HUM, WP_DEWPT, WP_DPDEP, WP_N };
+    INumber *weatherParam[WP_N] {};
+    
     float   Temp;
     float   Hum;
     float   DewPt;
     float   DpDep;
     float   VoltsIn;
     float   AmpsIn;
-    float   AmpHrs;
-    float   WattHrs;
     float   perpwr = 0;
     float   lastDew1PerPwr = 0;
     float   lastDew2PerPwr = 0;
@@ -178,6 +196,14 @@ private:
     ISwitch PowerClearS[0] {};
     ISwitchVectorProperty PowerClearSP;
     
+    // Per port energy, Ah and Wh of each PSEnergy port (kept in the config)
+    PSEnergy energy;
+    INumber EnergyN[PSEnergy::PS_E_N * 2];
+    INumberVectorProperty EnergyNP;
+    time_t lastEnergySave { 0 };
+    bool energyLoaded { false };            // saved totals applied, once per run
+    void publishEnergy();
+    
     // turn all devices off
     ISwitch TurnAllOffS[0] {};
     ISwitchVectorProperty TurnAllOffSP;
@@ -460,7 +486,327 @@ private:
     INumber NoneDisplayN[NoneDisplay_N];
     INumberVectorProperty NoneDisplayNP;
     
-    PowerStarProfile curProfile;
+    PowerStarProfile curProfile {};
+    
+    // Telemetry history
+    PSHistory history;
+    vector<char> historyBuf;
+    
+    enum {
+        HIST_CHANNEL,
+        HIST_FROM,
+        HIST_TO,
+        HIST_RES,
+        HistQuery_N,
+    };
+    IText HistoryQueryT[HistQuery_N];
+    ITextVectorProperty HistoryQueryTP;
+    
+    IBLOB HistoryB[1];
+    IBLOBVectorProperty HistoryBP;
+    
+    // Telemetry journal
+    PSJournal journal;
+    
+    enum {
+        JOURNAL_ON,
+        JOURNAL_OFF,
+        Journal_N,
+    };
+    ISwitch JournalS[Journal_N];
+    ISwitchVectorProperty JournalSP;
+    
+    IText JournalDirT[1];
+    ITextVectorProperty JournalDirTP;
+    
+    enum {
+        JOURNAL_SEGMENT_MB,
+        JOURNAL_KEEP,
+        JournalSet_N,
+    };
+    INumber JournalSetN[JournalSet_N];
+    INumberVectorProperty JournalSetNP;
+    
+    // Compressed telemetry export
+    PSExport exporter;
+    
+    enum {
+        EXPORT_ON,
+        EXPORT_OFF,
+        Export_N,
+    };
+    ISwitch ExportS[Export_N];
+    ISwitchVectorProperty ExportSP;
+    
+    // Burst capture
+    PSBurst burst;
+    
+    ISwitch BurstChanS[PS_BURST_CHANNELS];
+    ISwitchVectorProperty BurstChanSP;
+    
+    enum {
+        BURST_SECONDS,
+        BURST_THRESHOLD,
+        BurstSet_N,
+    };
+    INumber BurstSetN[BurstSet_N];
+    INumberVectorProperty BurstSetNP;
+    
+    ISwitch BurstS[1];
+    ISwitchVectorProperty BurstSP;
+    
+    enum {
+        BURST_PEAK,
+        BURST_RMS,
+        BURST_OVER,
+        BURST_SAMPLES,
+        BURST_RATE,
+        BurstStats_N,
+    };
+    INumber BurstStatsN[BurstStats_N];
+    INumberVectorProperty BurstStatsNP;
+    
+    IBLOB BurstB[1];
+    IBLOBVectorProperty BurstBP;
+    
+    // Prometheus exporter
+    PSMetrics metrics;
+    
+    enum {
+        METRICS_OFF,
+        METRICS_FILE,
+        METRICS_SOCKET,
+        Metrics_N,
+    };
+    ISwitch MetricsS[Metrics_N];
+    ISwitchVectorProperty MetricsSP;
+    
+    enum {
+        METRICS_FILE_PATH,
+        METRICS_SOCKET_PATH,
+        MetricsPath_N,
+    };
+    IText MetricsPathT[MetricsPath_N] {};
+    ITextVectorProperty MetricsPathTP;
+    
+    INumber MetricsPeriodN[1];
+    INumberVectorProperty MetricsPeriodNP;
+    
+    int metricsCallback { -1 };
+    time_t lastMetrics { 0 };
+    uint64_t tickCount { 0 };
+    double lastTickSec { 0 };
+    uint32_t lastFaults { 0 };
+    bool startMetrics();
+    void stopMetrics();
+    void publishMetrics(bool up);
+    static void serveMetrics(int fd, void *self);
+    
+    /******************/
+    /* Diagnostics    */
+    /******************/
+    // USB command statistics (PSdiag), all commands together
+    enum {
+        DIAG_CALLS,
+        DIAG_TIMEOUTS,
+        DIAG_RETRIES,
+        DIAG_ERRORS,
+        DIAG_P50,
+        DIAG_P95,
+        DIAG_P99,
+        DIAG_MAX,
+        DiagCounts_N,
+    };
+    INumber DiagCountsN[DiagCounts_N];
+    INumberVectorProperty DiagCountsNP;
+    
+    // one line per command in psDiagShown, allocated once at DIAG_LINE
+    enum { DIAG_LINE = 160 };
+    IText DiagLatencyT[PS_DIAG_SHOWN] {};
+    ITextVectorProperty DiagLatencyTP;
+    
+    // poll timing (PSpoll)
+    PSPoll poll;
+    
+    enum {
+        POLL_TICK,
+        POLL_TICK_AVG,
+        POLL_ACTUAL,
+        POLL_JITTER,
+        POLL_TARGET,
+        POLL_OVERRUNS,
+        PollStats_N,
+    };
+    INumber PollStatsN[PollStats_N];
+    INumberVectorProperty PollStatsNP;
+    
+    enum {
+        POLL_FIXED,
+        POLL_ADAPTIVE,
+        PollMode_N,
+    };
+    ISwitch PollModeS[PollMode_N];
+    ISwitchVectorProperty PollModeSP;
+    
+    enum {
+        POLL_PERIOD,
+        POLL_MIN,
+        POLL_MAX,
+        PollSet_N,
+    };
+    INumber PollSetN[PollSet_N];
+    INumberVectorProperty PollSetNP;
+    void publishPoll();
+    
+    // focuser tracking, a short timer of its own while a move is active
+    enum {
+        TRACK_ON,
+        TRACK_OFF,
+        FocusTrack_N,
+    };
+    ISwitch FocusTrackS[FocusTrack_N];
+    ISwitchVectorProperty FocusTrackSP;
+    enum {
+        TRACK_PERIOD,
+        TRACK_CLIENT_HZ,
+        FocusTrackSet_N,
+    };
+    INumber FocusTrackN[FocusTrackSet_N];
+    INumberVectorProperty FocusTrackNP;
+    int trackTimer { -1 };
+    bool trackSawMoving { false };
+    double trackWakeMs { 0 };           // move time at which polling starts
+    double focusSentMs { 0 };           // move time of the last client update
+    
+    // predicted move time, the tracker sleeps until just before it
+    PSMotion motion;
+    enum {
+        ETA_REMAINING,
+        ETA_TOTAL,
+        FocusEta_N,
+    };
+    INumber FocusEtaN[FocusEta_N];
+    INumberVectorProperty FocusEtaNP;
+    uint32_t moveFrom { 0 };
+    struct timespec moveStart {};
+    double moveElapsedMs();
+    bool updateFocus();
+    void publishFocus(bool final);
+    void startTracking();
+    void stopTracking();
+    void trackFocus();
+    static void trackFocusHelper(void *self);
+    
+    // queued sweep of absolute targets, each leg started as the last one arrives
+    PSMoveQueue queue;
+    IText FocusQueueT[1] {};
+    ITextVectorProperty FocusQueueTP;
+    INumber FocusQueueSetN[1];
+    INumberVectorProperty FocusQueueSetNP;
+    enum {
+        QUEUE_REACHED,
+        QUEUE_TARGETS,
+        QUEUE_POSITION,
+        QUEUE_STEP_MS,
+        FocusQueue_N,
+    };
+    INumber FocusQueueN[FocusQueue_N];
+    INumberVectorProperty FocusQueueNP;
+    vector<uint32_t> queueTargets;
+    bool queueMoving { false };         // MoveAbsFocuser called for a queue leg
+    bool legArrival { false };          // the leg under way ends at a target
+    double queueStepMs { 0 };           // move time since the last target
+    bool startQueue();
+    bool nextQueueLeg();
+    void cancelQueue(const char *why);
+    
+    // driver side temperature compensation, between exposures
+    PSTempComp tcomp;
+    enum {
+        TC_ON,
+        TC_OFF,
+        Tcomp_N,
+    };
+    ISwitch TcompS[Tcomp_N];
+    ISwitchVectorProperty TcompSP;
+    enum {
+        TC_HYSTERESIS,
+        TC_MAX_STEP,
+        TC_INTERVAL,
+        TcompSet_N,
+    };
+    INumber TcompSetN[TcompSet_N];
+    INumberVectorProperty TcompSetNP;
+    enum {
+        TC_RECORD,
+        TC_CLEAR,
+        TcompPoints_N,
+    };
+    ISwitch TcompPointsS[TcompPoints_N];
+    ISwitchVectorProperty TcompPointsSP;
+    enum {
+        TC_POINTS,
+        TC_ORDER,
+        TC_SLOPE,
+        TC_OFFSET,
+        TcompModel_N,
+    };
+    INumber TcompModelN[TcompModel_N];
+    INumberVectorProperty TcompModelNP;
+    enum {
+        SNOOP_CCD,
+        SNOOP_FILTER,
+        ActiveDevices_N,
+    };
+    IText ActiveDevicesT[ActiveDevices_N] {};
+    ITextVectorProperty ActiveDevicesTP;
+    bool ccdBusy { false };             // snooped CCD_EXPOSURE
+    bool tcMoving { false };            // MoveAbsFocuser called by compensateTemp
+    string tcompPath();
+    double tempC() { return psTempC(psctl.chanRaw[PS_CH_TEMP]); }
+    void compensateTemp();
+    void publishTcomp();
+    
+    // past focus runs, to start a session or filter near focus
+    PSFocusLog focusLog;
+    INumber FocusLogN[1];
+    INumberVectorProperty FocusLogNP;
+    enum {
+        LOG_JUMP_AUTO,
+        LOG_JUMP_OFF,
+        FocusLogJump_N,
+    };
+    ISwitch FocusLogJumpS[FocusLogJump_N];
+    ISwitchVectorProperty FocusLogJumpSP;
+    ISwitch FocusLogGoS[1];
+    ISwitchVectorProperty FocusLogGoSP;
+    enum {
+        LOG_ENTRIES,
+        LOG_PREDICTED,
+        LOG_NEAREST_DT,
+        FocusLogPred_N,
+    };
+    INumber FocusLogPredN[FocusLogPred_N];
+    INumberVectorProperty FocusLogPredNP;
+    vector<string> filterNames;         // snooped FILTER_NAME
+    int filterSlot { 0 };               // snooped FILTER_SLOT, 0 unknown
+    string filterName;                  // "" without a filter wheel
+    bool logJumpPending { false };      // session start or filter change
+    double logPredTemp { -273 };        // C the prediction shown is for
+    string focusLogPath();
+    void snoopFilter(XMLEle *root, const char *prop);
+    void checkFocusLog();
+    bool jumpToPredicted(const char *why);
+    void publishFocusLog();
+    
+    ISwitch DiagResetS[1];
+    ISwitchVectorProperty DiagResetSP;
+    
+    ISwitch TraceDumpS[1];
+    ISwitchVectorProperty TraceDumpSP;
+    
+    time_t lastDiag { 0 };
+    void publishDiag();
     
     static constexpr const char *POWER_TAB {"Power"};
     static constexpr const char *USB_TAB {"USB"};
@@ -468,5 +814,7 @@ private:
     static constexpr const char *FAULTS_TAB {"Faults"};
     static constexpr const char *USRLIMIT_TAB {"User Limits"};
     static constexpr const char *ENVIRONMENT_TAB {"Environment"};
+    static constexpr const char *TELEMETRY_TAB {"Telemetry"};
+    static constexpr const char *DIAG_TAB {"Diagnostics"};
 };
 
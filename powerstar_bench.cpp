@@ -0,0 +1,790 @@
+/***************************************************************
+*  Program:      powerstar_bench.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Power*Star driver hot path benchmarks
+*
+*  Runs the driver against the emulator and reports the latency
+*  distribution and heap allocations of each hot path.
+*
+*  Usage: powerstar_bench [-n iterations] [-e emulator settings] [-a ticks] [-s days] [-d runs] [-t runs] [name ...]
+*     -n   calls per benchmark (default 200)
+*     -e   PS_EMULATE settings, default has no USB delay so the
+*          numbers are the driver's own CPU cost (-t: the emulator's
+*          USB timing)
+*     -a   instead of the benchmarks run this many TimerHits, list
+*          their allocations by the first object calling them that
+*          isn't libc and exit 1 if any came from outside libindi
+*     -s   instead of the benchmarks poll back to back for this many
+*          days of driver time, switching ports and injecting faults
+*          and USB dropouts, exit 1 if RSS, fds or threads grew
+*     -d   instead of the benchmarks run this many autofocus sweeps of
+*          relative moves while the temperature drifts and the hub's
+*          temperature compensation follows it, and count the moves
+*          that would need a correction
+*     -t   instead of the benchmarks start the driver this many times
+*          with a saved config and report the time to its first property
+*          and to the hub's, with the USB commands and sessions opened
+*          for each, exit 1 if any were before Connect
+*     name run only the benchmarks containing this text
+****************************************************************/
+
+#include "indi_PowerStar.h"
+#include "PSemulator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/***************************************************************/
+/* Heap accounting                                             */
+/***************************************************************/
+// Every heap allocation goes through malloc/calloc/realloc or operator
+// new below, so counting there sees them all.  While the -a check runs
+// the call stack of each one is kept too, and afterwards put down to the
+// executable or shared library that made it.
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+static atomic<uint64_t> allocCount { 0 };
+static atomic<uint64_t> allocBytes { 0 };
+
+// call stacks of the allocations in the -a check, innermost first from
+// the allocation's caller
+#define BENCH_CALLERS       16384
+#define BENCH_FRAMES        12
+typedef struct {
+            void    *frames[BENCH_FRAMES];
+            int      depth;
+} benchStack;
+static benchStack callers[BENCH_CALLERS];
+static atomic<uint32_t> callerCount { 0 };
+static atomic<bool> keepCallers { false };
+// backtrace() can allocate itself, those aren't followed
+static thread_local bool inBacktrace = false;
+
+static inline void counted(size_t size, void *caller)
+{
+    allocCount.fetch_add(1, memory_order_relaxed);
+    allocBytes.fetch_add(size, memory_order_relaxed);
+    if (keepCallers.load(memory_order_relaxed) && !inBacktrace)
+    {
+        uint32_t i = callerCount.fetch_add(1, memory_order_relaxed);
+        if (i >= BENCH_CALLERS)
+            return;
+
+        void *frames[BENCH_FRAMES + 4];
+        inBacktrace = true;
+        int n = backtrace(frames, BENCH_FRAMES + 4);
+        inBacktrace = false;
+
+        // drop the hook's own frames, the stack starts at the caller
+        int at = 0;
+        while (at < n && frames[at] != caller)
+            at++;
+        benchStack &s = callers[i];
+        s.depth = 0;
+        if (at == n)
+            s.frames[s.depth++] = caller;
+        else
+            for (; at < n && s.depth < BENCH_FRAMES; at++)
+                s.frames[s.depth++] = frames[at];
+    }
+}
+
+extern "C" void *malloc(size_t size)
+{
+    counted(size, __builtin_return_address(0));
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    counted(n * size, __builtin_return_address(0));
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size)
+{
+    counted(size, __builtin_return_address(0));
+    return __libc_realloc(p, size);
+}
+
+// counted here so the caller is whoever used new, not this
+void *operator new(size_t size)
+{
+    counted(size, __builtin_return_address(0));
+    void *p = __libc_malloc(size ? size : 1);
+    if (p == nullptr)
+        throw bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    counted(size, __builtin_return_address(0));
+    void *p = __libc_malloc(size ? size : 1);
+    if (p == nullptr)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+/***************************************************************/
+/* Harness                                                     */
+/***************************************************************/
+// reaches the driver's private parts
+class PSBench
+{
+    public:
+        static uint32_t checkFaults(PSpower &ps) { return ps.checkFaults(); }
+
+        // next tick also does the 10 second diagnostics refresh
+        static void refreshDiag(PSpower &ps) { ps.lastDiag = 0; }
+
+        static uint32_t pollMs(PSpower &ps) { return ps.POLLMS; }
+
+        // moves followed by TimerHit, the bench runs no INDI timers
+        static void trackInPoll(PSpower &ps)
+        {
+            IUResetSwitch(&ps.FocusTrackSP);
+            ps.FocusTrackS[PSpower::TRACK_OFF].s = ISS_ON;
+        }
+
+        // as the Options tab would
+        static void setProfile(PSpower &ps, const PowerStarProfile &p)
+        {
+            ps.curProfile = p;
+            ps.psctl.setProfileStatus(p);
+        }
+
+        static uint32_t shownPosition(PSpower &ps) { return ps.FocusAbsPosN[0].value; }
+        static uint32_t target(PSpower &ps) { return ps.targetPosition; }
+        static bool moving(PSpower &ps) { return ps.FocusAbsPosNP.s == IPS_BUSY; }
+};
+
+static FILE *out = stdout;
+static int iterations = 200;
+static vector<const char *> filters;
+static vector<double> samples;
+
+//******************************************************************
+static bool selected(const char *name)
+{
+    if (filters.empty())
+        return true;
+    for (const char *f : filters)
+    {
+        if (strstr(name, f) != nullptr)
+            return true;
+    }
+    return false;
+}
+
+//******************************************************************
+static void bench(const char *name, const function<void()> &fn)
+{
+    if (!selected(name))
+        return;
+
+    // warm up caches, maps and lazily sized buffers
+    for (int i = 0; i < 3; i++)
+        fn();
+
+    samples.resize(iterations);
+    uint64_t count0 = allocCount.load(memory_order_relaxed);
+    uint64_t bytes0 = allocBytes.load(memory_order_relaxed);
+
+    for (int i = 0; i < iterations; i++)
+    {
+        auto t0 = chrono::steady_clock::now();
+        fn();
+        auto t1 = chrono::steady_clock::now();
+        samples[i] = chrono::duration<double, micro>(t1 - t0).count();
+    }
+
+    double allocs = double(allocCount.load(memory_order_relaxed) - count0) / iterations;
+    double bytes = double(allocBytes.load(memory_order_relaxed) - bytes0) / iterations;
+
+    sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double s : samples)
+        sum += s;
+    auto pct = [](double p) { return samples[size_t(p * (samples.size() - 1))]; };
+
+    fprintf(out, "%-22s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.0f\n", name,
+            samples.front(), pct(0.50), pct(0.90), pct(0.99), samples.back(), sum / iterations, allocs, bytes);
+}
+
+//******************************************************************
+// The only allocations a steady state TimerHit may make: those libindi
+// makes, its IEAddTimer node and the C locale its IDSet*/IDMessage get
+// from libc's newlocale().  An allocation is put down to the first
+// object on its stack that isn't libc, so the driver's own strdup(),
+// fopen() or std::string is counted against the driver.
+static const char *allocExempt[] = { "libindidriver.so" };
+static const char *allocThrough[] = { "libc.so" };
+
+static const char *baseName(const char *object)
+{
+    const char *base = strrchr(object, '/');
+    return base ? base + 1 : object;
+}
+
+static bool listed(const char *object, const char *const *list, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        if (strncmp(baseName(object), list[i], strlen(list[i])) == 0)
+            return true;
+    return false;
+}
+
+static string allocOwner(const benchStack &s)
+{
+    string object = "?";
+    for (int f = 0; f < s.depth; f++)
+    {
+        Dl_info info;
+        object = dladdr(s.frames[f], &info) && info.dli_fname ? info.dli_fname : "?";
+        if (!listed(object.c_str(), allocThrough, sizeof(allocThrough) / sizeof(allocThrough[0])))
+            return object;
+    }
+    // libc all the way down, or deeper than the stack kept
+    return object + " (no caller)";
+}
+
+//******************************************************************
+// Runs work with the allocations counted by owner, prints them when out
+// is given, and returns how many aren't exempt
+static uint64_t allocsOutside(const function<void()> &work, FILE *report)
+{
+    // backtrace() loads its unwinder on first use
+    void *prime[1];
+    backtrace(prime, 1);
+
+    uint64_t count0 = allocCount.load(memory_order_relaxed);
+    callerCount.store(0);
+    keepCallers.store(true);
+    work();
+    keepCallers.store(false);
+    uint64_t total = allocCount.load(memory_order_relaxed) - count0;
+    uint32_t kept = min(callerCount.load(), uint32_t(BENCH_CALLERS));
+
+    vector<pair<string, uint64_t>> owners;
+    for (uint32_t i = 0; i < kept; i++)
+    {
+        string owner = allocOwner(callers[i]);
+        auto o = find_if(owners.begin(), owners.end(), [&](const pair<string, uint64_t> &e) { return e.first == owner; });
+        if (o == owners.end())
+            owners.push_back(make_pair(owner, 1));
+        else
+            o->second++;
+    }
+
+    uint64_t failed = total - kept;
+    if (report != nullptr && failed)
+        fprintf(report, "  %-40s %lu\n", "(too many to attribute)", (unsigned long)failed);
+    for (auto &o : owners)
+    {
+        bool exempt = listed(o.first.c_str(), allocExempt, sizeof(allocExempt) / sizeof(allocExempt[0]));
+        if (report != nullptr)
+            fprintf(report, "  %-40s %lu%s\n", o.first.c_str(), (unsigned long)o.second, exempt ? " (exempt)" : "");
+        if (!exempt)
+            failed += o.second;
+    }
+    return failed;
+}
+
+//******************************************************************
+// Steady state TimerHit must not allocate, fails if it did outside allocExempt
+static int allocCheck(PSpower &ps, int ticks)
+{
+    // the check itself: a strdup() from outside libindi must count
+    if (allocsOutside([] { free(strdup("tick")); }, nullptr) == 0)
+    {
+        fprintf(out, "FAIL: a strdup() in a tick was not counted\n");
+        return 1;
+    }
+
+    // first ticks size whatever is sized lazily
+    for (int i = 0; i < 20; i++)
+        ps.TimerHit();
+
+    fprintf(out, "%d ticks, by the first caller outside", ticks);
+    for (const char *lib : allocThrough)
+        fprintf(out, " %s", lib);
+    fprintf(out, ", exempt:");
+    for (const char *lib : allocExempt)
+        fprintf(out, " %s", lib);
+    fprintf(out, "\n");
+
+    uint64_t failed = allocsOutside([&]
+    {
+        for (int i = 0; i < ticks; i++)
+        {
+            // the timed refreshes would not come up in a fast run
+            if (i % 1000 == 0)
+                PSBench::refreshDiag(ps);
+            ps.TimerHit();
+        }
+    }, out);
+
+    if (failed != 0)
+    {
+        fprintf(out, "FAIL: TimerHit allocates in steady state\n");
+        return 1;
+    }
+    fprintf(out, "PASS\n");
+    return 0;
+}
+
+/***************************************************************/
+/* Soak                                                        */
+/***************************************************************/
+// process footprint, from /proc/self
+typedef struct {
+            long rssKb;
+            int  fds;
+            int  threads;
+} soakSample;
+
+// RSS may move by a few pages (stdio buffers, malloc arenas) without leaking
+#define PS_SOAK_RSS_SLACK_KB    256
+#define PS_SOAK_SAMPLES         10
+
+// drift: falling temperature and the exposure between autofocus steps
+#define PS_DRIFT_C_PER_SEC      0.5
+#define PS_DRIFT_EXPOSURE_MS    300
+
+//******************************************************************
+static soakSample sampleProcess()
+{
+    soakSample s = { 0, 0, 0 };
+    long pages = 0;
+    char line[128];
+
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp != nullptr)
+    {
+        if (fscanf(fp, "%*s %ld", &pages) == 1)
+            s.rssKb = pages * (sysconf(_SC_PAGESIZE) / 1024);
+        fclose(fp);
+    }
+
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir != nullptr)
+    {
+        struct dirent *e;
+        while ((e = readdir(dir)) != nullptr)
+        {
+            if (e->d_name[0] != '.')
+                s.fds++;
+        }
+        closedir(dir);
+        s.fds--;        // the one opendir is using
+    }
+
+    fp = fopen("/proc/self/status", "r");
+    if (fp != nullptr)
+    {
+        while (fgets(line, sizeof(line), fp) != nullptr)
+        {
+            if (sscanf(line, "Threads: %d", &s.threads) == 1)
+                break;
+        }
+        fclose(fp);
+    }
+    return s;
+}
+
+//******************************************************************
+// Polls back to back, days of TimerHits at the configured period, with
+// the switching and USB trouble of a long run mixed in.  Fails if RSS,
+// open fds or threads grew after the first tenth of the run.
+static int soak(PSpower &ps, double days)
+{
+    PSEmulator &emu = psEmulator();
+    const uint32_t period = PSBench::pollMs(ps);
+    const uint64_t perHour = 3600000 / period;
+    const uint64_t ticks = uint64_t(days * 24 * perHour);
+    const uint64_t step = ticks / PS_SOAK_SAMPLES ? ticks / PS_SOAK_SAMPLES : 1;
+    PowerStarProfile profile = ps.psctl.getProfileStatus();
+    soakSample base = { 0, 0, 0 };
+    soakSample s = base;
+    bool on = false;
+    int failed = 0;
+
+    fprintf(out, "soak: %.1f days at %u ms = %lu ticks\n", days, period, (unsigned long)ticks);
+    fprintf(out, "%9s %10s %10s %10s %6s %8s\n", "sim days", "ticks", "ticks/s", "rss kB", "fds", "threads");
+
+    auto start = chrono::steady_clock::now();
+    auto lap = start;
+    for (uint64_t i = 1; i <= ticks; i++)
+    {
+        // every few minutes a port is switched
+        if (i % (perHour / 12) == 0)
+            ps.psctl.setPowerState("out1", (on = !on) ? "yes" : "no");
+
+        // every hour the profile is read and written back, a fault comes and goes
+        if (i % perHour == 0)
+        {
+            profile = ps.psctl.getProfileStatus();
+            ps.psctl.setProfileStatus(profile);
+            emu.injectFault(0x0001, 0);
+        }
+
+        // every 6 hours the hub drops off the bus for a few polls
+        if (i % (6 * perHour) == 0)
+            emu.setPresent(false);
+        if (i % (6 * perHour) == 3)
+            emu.setPresent(true);
+
+        // twice a day a reply is lost (a full PS_TIMEOUT)
+        if (i % (12 * perHour) == perHour / 2)
+            emu.dropReplies(1);
+
+        ps.TimerHit();
+
+        if (i % step == 0 || i == ticks)
+        {
+            auto now = chrono::steady_clock::now();
+            double secs = chrono::duration<double>(now - lap).count();
+            uint64_t done = i % step ? i % step : step;
+            lap = now;
+
+            s = sampleProcess();
+            if (i == step)
+                base = s;
+            fprintf(out, "%9.2f %10lu %10.0f %10ld %6d %8d\n", double(i) / (24 * perHour),
+                    (unsigned long)i, done / secs, s.rssKb, s.fds, s.threads);
+        }
+    }
+
+    double total = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    fprintf(out, "%lu ticks in %.1f s, %.0f ticks/s, %u emulated commands\n", (unsigned long)ticks,
+            total, ticks / total, emu.commandCount());
+    psDiagSummary all = psDiag().total();
+    fprintf(out, "USB: %lu timeouts, %lu open retries, %lu errors\n", (unsigned long)all.timeouts,
+            (unsigned long)all.retries, (unsigned long)all.errors);
+
+    if (s.rssKb > base.rssKb + PS_SOAK_RSS_SLACK_KB)
+    {
+        fprintf(out, "FAIL: RSS grew from %ld to %ld kB\n", base.rssKb, s.rssKb);
+        failed = 1;
+    }
+    if (s.fds > base.fds)
+    {
+        fprintf(out, "FAIL: open fds grew from %d to %d\n", base.fds, s.fds);
+        failed = 1;
+    }
+    if (s.threads > base.threads)
+    {
+        fprintf(out, "FAIL: threads grew from %d to %d\n", base.threads, s.threads);
+        failed = 1;
+    }
+    if (!failed)
+        fprintf(out, "PASS\n");
+    return failed;
+}
+
+//******************************************************************
+// Polls at the driver's period for ms of real time, the emulated focuser
+// moves in real time
+static void pollFor(PSpower &ps, double ms)
+{
+    auto end = chrono::steady_clock::now() + chrono::microseconds(long(ms * 1000));
+    while (chrono::steady_clock::now() < end)
+    {
+        auto next = chrono::steady_clock::now() + chrono::milliseconds(PSBench::pollMs(ps));
+        ps.TimerHit();
+        this_thread::sleep_until(min(next, end));
+    }
+}
+
+//******************************************************************
+// Autofocus sweeps of relative moves with an exposure between them,
+// while the temperature falls and the hub's temperature compensation
+// moves the focuser.  A move whose target isn't the live position plus
+// the step lands off and costs autofocus a correction move; counts
+// those for targets taken from the position shown by the last poll
+// (how relative moves used to work) and for the driver's.
+static int drift(PSpower &ps, int runs)
+{
+    PSEmulator &emu = psEmulator();
+    PowerStarProfile saved = ps.psctl.getProfileStatus();
+    PowerStarProfile profile = saved;
+    static const int sweep[] = { 300, -100, -100, -100, -100, -100, 200 };
+    uint32_t moves = 0, staleMiss = 0, driverMiss = 0;
+    double staleErr = 0, driverErr = 0;
+
+    // 20 steps/C once the change reaches 0.2 C, on the env sensor
+    profile.tempCoef = 20;
+    profile.tempHysterisis = 0.2;
+    profile.tempSensor = 2;
+    PSBench::setProfile(ps, profile);
+    PSBench::trackInPoll(ps);
+    emu.setDrift(-PS_DRIFT_C_PER_SEC);
+
+    fprintf(out, "drift: %d sweeps, %.2f C/s, hub compensation 20 steps/C, %u ms poll\n", runs,
+            PS_DRIFT_C_PER_SEC, PSBench::pollMs(ps));
+
+    for (int r = 0; r < runs; r++)
+    {
+        for (int rel : sweep)
+        {
+            // the exposure
+            pollFor(ps, PS_DRIFT_EXPOSURE_MS);
+
+            uint32_t shown = PSBench::shownPosition(ps);
+            uint32_t live = emu.position();
+            ps.MoveRelFocuser(rel < 0 ? INDI::FocuserInterface::FOCUS_INWARD : INDI::FocuserInterface::FOCUS_OUTWARD, abs(rel));
+
+            int64_t want = int64_t(live) + rel;
+            int64_t stale = int64_t(shown) + rel - want;
+            int64_t driver = int64_t(PSBench::target(ps)) - want;
+            moves++;
+            staleMiss += stale != 0;
+            driverMiss += driver != 0;
+            staleErr += llabs(stale);
+            driverErr += llabs(driver);
+
+            while (PSBench::moving(ps))
+                pollFor(ps, PSBench::pollMs(ps));
+        }
+    }
+
+    emu.setDrift(0);
+    PSBench::setProfile(ps, saved);
+
+    fprintf(out, "%u moves\n", moves);
+    fprintf(out, "target from the shown position: %u need a correction, mean miss %.1f steps\n",
+            staleMiss, staleErr / moves);
+    fprintf(out, "target from the live position:  %u need a correction, mean miss %.1f steps\n",
+            driverMiss, driverErr / moves);
+    return driverMiss > staleMiss;
+}
+
+//******************************************************************
+// Cold starts as indiserver does them: ISGetProperties, whose properties
+// are the first a client sees, then Connect and updateProperties, after
+// which the hub's are there.  Times are from the start of
+// ISGetProperties.  The config is one a connected driver saved, in a
+// scratch INDICONFIG so the user's own is left alone.
+static int startup(int runs, const char *emulate)
+{
+    PSEmulator &emu = psEmulator();
+    vector<double> first, ready;
+    uint32_t cmdsFirst = 0, opensFirst = 0, cmdsReady = 0, opensReady = 0;
+    // kept, their poll timers are still registered
+    vector<unique_ptr<PSpower>> drivers;
+
+    char dir[] = "/tmp/powerstar_bench-XXXXXX";
+    if (mkdtemp(dir) == nullptr)
+    {
+        fprintf(stderr, "powerstar_bench: no scratch directory for the config\n");
+        return 1;
+    }
+    string config = string(dir) + "/config.xml";
+    setenv("INDICONFIG", config.c_str(), 1);
+
+    drivers.emplace_back(new PSpower());
+    PSpower &saver = *drivers.back();
+    saver.ISGetProperties(nullptr);
+    if (!saver.Connect())
+    {
+        fprintf(stderr, "powerstar_bench: emulator did not connect\n");
+        return 1;
+    }
+    saver.setConnected(true);
+    saver.updateProperties();
+    saver.saveConfig(true);
+    saver.Disconnect();
+    saver.setConnected(false);
+    saver.updateProperties();
+
+    fprintf(out, "startup: %d runs, emulator: %s, config: %s\n", runs, emulate, config.c_str());
+
+    for (int r = 0; r < runs; r++)
+    {
+        drivers.emplace_back(new PSpower());
+        PSpower &ps = *drivers.back();
+
+        uint32_t cmds0 = emu.commandCount();
+        uint32_t opens0 = emu.openCount();
+        auto t0 = chrono::steady_clock::now();
+
+        ps.ISGetProperties(nullptr);
+        auto t1 = chrono::steady_clock::now();
+        cmdsFirst = emu.commandCount() - cmds0;
+        opensFirst = emu.openCount() - opens0;
+
+        if (!ps.Connect())
+        {
+            fprintf(stderr, "powerstar_bench: emulator did not connect\n");
+            return 1;
+        }
+        ps.setConnected(true);
+        ps.updateProperties();
+        auto t2 = chrono::steady_clock::now();
+        cmdsReady = emu.commandCount() - cmds0;
+        opensReady = emu.openCount() - opens0;
+
+        first.push_back(chrono::duration<double, milli>(t1 - t0).count());
+        ready.push_back(chrono::duration<double, milli>(t2 - t0).count());
+
+        ps.Disconnect();
+        ps.setConnected(false);
+        ps.updateProperties();
+    }
+
+    sort(first.begin(), first.end());
+    sort(ready.begin(), ready.end());
+    fprintf(out, "%-22s %9s %9s %9s %9s %9s\n", "", "min", "p50", "max", "commands", "opens");
+    fprintf(out, "%-22s %9.1f %9.1f %9.1f %9u %9u\n", "first property (ms)",
+            first.front(), first[first.size() / 2], first.back(), cmdsFirst, opensFirst);
+    fprintf(out, "%-22s %9.1f %9.1f %9.1f %9u %9u\n", "hub properties (ms)",
+            ready.front(), ready[ready.size() / 2], ready.back(), cmdsReady, opensReady);
+
+    // the config, and the backup INDI may have made of it
+    DIR *d = opendir(dir);
+    if (d != nullptr)
+    {
+        struct dirent *e;
+        while ((e = readdir(d)) != nullptr)
+            if (e->d_name[0] != '.')
+                unlink((string(dir) + "/" + e->d_name).c_str());
+        closedir(d);
+    }
+    rmdir(dir);
+
+    // nothing may reach the hub before Connect
+    return cmdsFirst != 0 || opensFirst != 0;
+}
+
+//******************************************************************
+static void usage()
+{
+    fprintf(stderr, "Usage: powerstar_bench [-n iterations] [-e emulator settings] [-a ticks] [-s days] [-d runs] [-t runs] [name ...]\n");
+}
+
+//******************************************************************
+int main(int argc, char *argv[])
+{
+    const char *emulate = nullptr;
+    int checkTicks = 0;
+    double soakDays = 0;
+    int driftRuns = 0;
+    int startupRuns = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:e:a:s:d:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                iterations = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 'e':
+                emulate = optarg;
+                break;
+            case 'a':
+                checkTicks = atoi(optarg) > 0 ? atoi(optarg) : 10000;
+                break;
+            case 's':
+                soakDays = atof(optarg) > 0 ? atof(optarg) : 14;
+                break;
+            case 'd':
+                driftRuns = atoi(optarg) > 0 ? atoi(optarg) : 5;
+                break;
+            case 't':
+                startupRuns = atoi(optarg) > 0 ? atoi(optarg) : 10;
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    for (int i = optind; i < argc; i++)
+        filters.push_back(argv[i]);
+
+    // startup is all USB round trips, time it with the emulator's
+    if (emulate == nullptr)
+        emulate = startupRuns > 0 ? "1" : "latency=0,jitter=0,open=0";
+
+    // the driver only looks at this when a PSCTL is made
+    setenv("PS_EMULATE", emulate, 1);
+
+    // INDI writes the properties to stdout, keep the results apart
+    int saved = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+    out = fdopen(saved, "w");
+    setvbuf(out, nullptr, _IOLBF, 0);
+
+    if (startupRuns > 0)
+        return startup(startupRuns, emulate);
+
+    PSpower ps;
+    ps.ISGetProperties(nullptr);
+    if (!ps.Connect())
+    {
+        fprintf(stderr, "powerstar_bench: emulator did not connect\n");
+        return 1;
+    }
+    ps.setConnected(true);
+    ps.updateProperties();
+
+    if (checkTicks > 0)
+        return allocCheck(ps, checkTicks);
+    if (soakDays > 0)
+        return soak(ps, soakDays);
+    if (driftRuns > 0)
+        return drift(ps, driftRuns);
+
+    fprintf(out, "emulator: %s, %d calls each, times in us\n", emulate, iterations);
+    fprintf(out, "%-22s %9s %9s %9s %9s %9s %9s %9s %9s\n", "benchmark",
+            "min", "p50", "p90", "p99", "max", "mean", "allocs", "bytes");
+
+    bench("getStatus", [&]() { ps.psctl.getStatus(); });
+
+    bench("checkFaults", [&]() { PSBench::checkFaults(ps); });
+
+    bench("getProfileStatus", [&]() { ps.psctl.getProfileStatus(); });
+
+    PowerStarProfile profile = ps.psctl.getProfileStatus();
+    bench("setProfileStatus", [&]() { ps.psctl.setProfileStatus(profile); });
+
+    bool on = false;
+    bench("setPowerState", [&]() { ps.psctl.setPowerState("out1", (on = !on) ? "yes" : "no"); });
+
+    bench("TimerHit", [&]() { ps.TimerHit(); });
+
+    fprintf(out, "%u emulated commands\n", psEmulator().commandCount());
+    return 0;
+}
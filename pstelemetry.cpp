@@ -0,0 +1,212 @@
+/***************************************************************
+*  Program:      pstelemetry.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Decode Power*Star telemetry files to CSV
+*
+*  Usage: pstelemetry [-r] [-f from] [-t to] [-c out.psc] file ...
+*     -r   write raw ADC counts instead of scaled values
+*     -f   skip samples before this unix time (seconds)
+*     -t   skip samples after this unix time (seconds)
+*     -c   pack the samples into a compressed export file instead
+*  Files may be journal segments (.psj) or exports (.psc).
+****************************************************************/
+
+#include "PSchannels.h"
+#include "PSjournal.h"
+#include "PSexport.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+static bool rawOut = false;
+static int64_t fromMs = INT64_MIN;
+static int64_t toMs = INT64_MAX;
+static PSExport exporter;
+
+static void usage()
+{
+    fprintf(stderr, "Usage: pstelemetry [-r] [-f from] [-t to] [-c out%s] file ...\n", PS_EXPORT_EXT);
+    fprintf(stderr, "   -r   write raw ADC counts instead of scaled values\n");
+    fprintf(stderr, "   -f   skip samples before this unix time (seconds)\n");
+    fprintf(stderr, "   -t   skip samples after this unix time (seconds)\n");
+    fprintf(stderr, "   -c   pack the samples into a compressed export file instead\n");
+    fprintf(stderr, "   files may be journal segments (%s) or exports (%s)\n", PS_JOURNAL_EXT, PS_EXPORT_EXT);
+}
+
+//******************************************************************
+static void printHeader()
+{
+    printf("time");
+    for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+        printf(",%s", psChannels[ch].name);
+    printf("\n");
+}
+
+//******************************************************************
+static void printRow(int64_t timeMs, const uint16_t raw[PS_CH_N], const bool seen[PS_CH_N])
+{
+    if (timeMs < fromMs || timeMs > toMs)
+        return;
+
+    if (exporter.isOpen())
+    {
+        exporter.append(timeMs, raw);
+        return;
+    }
+
+    float value[PS_CH_N];
+
+    // duty weighted channels need their percent channel scaled first
+    for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+    {
+        if (psChannels[ch].duty == PS_CH_N)
+            value[ch] = psScaleChannel(ch, raw[ch], 0);
+    }
+    for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+    {
+        if (psChannels[ch].duty != PS_CH_N)
+            value[ch] = psScaleChannel(ch, raw[ch], value[psChannels[ch].duty]);
+    }
+
+    printf("%lld.%03d", (long long)(timeMs / 1000), int(timeMs % 1000));
+    for (uint8_t ch = 0; ch < PS_CH_N; ch++)
+    {
+        if (!seen[ch])
+            printf(",");
+        else if (rawOut)
+            printf(",%u", raw[ch]);
+        else
+            printf(",%.4f", value[ch]);
+    }
+    printf("\n");
+}
+
+//******************************************************************
+static bool decodeJournal(const char *path)
+{
+    PSJournalReader reader;
+    if (!reader.open(path))
+    {
+        fprintf(stderr, "pstelemetry: %s is not a telemetry journal\n", path);
+        return false;
+    }
+
+    int64_t rowTime = -1;
+    int64_t timeMs;
+    uint8_t channel;
+    uint16_t value;
+    uint16_t raw[PS_CH_N] = {0};
+    bool seen[PS_CH_N] = {false};
+
+    // records of one sample share a timestamp, print one row per sample
+    while (reader.next(&timeMs, &channel, &value))
+    {
+        if (timeMs != rowTime && rowTime >= 0)
+        {
+            printRow(rowTime, raw, seen);
+            memset(seen, 0, sizeof(seen));
+        }
+        rowTime = timeMs;
+        raw[channel] = value;
+        seen[channel] = true;
+    }
+
+    if (rowTime >= 0)
+        printRow(rowTime, raw, seen);
+
+    return true;
+}
+
+//******************************************************************
+static bool decodeExport(const char *path)
+{
+    PSExportReader reader;
+    if (!reader.open(path))
+    {
+        fprintf(stderr, "pstelemetry: %s is not a telemetry export\n", path);
+        return false;
+    }
+
+    vector<int64_t> times;
+    vector<uint16_t> raw;
+    bool ok = reader.read(fromMs, toMs, times, raw);
+    if (!ok)
+        fprintf(stderr, "pstelemetry: %s is damaged, output is incomplete\n", path);
+
+    bool seen[PS_CH_N];
+    memset(seen, 1, sizeof(seen));
+    for (size_t r = 0; r < times.size(); r++)
+        printRow(times[r], &raw[r * PS_CH_N], seen);
+
+    return ok;
+}
+
+//******************************************************************
+int main(int argc, char *argv[])
+{
+    const char *outPath = nullptr;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "rf:t:c:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                rawOut = true;
+                break;
+            case 'f':
+                fromMs = strtoll(optarg, nullptr, 10) * 1000;
+                break;
+            case 't':
+                toMs = strtoll(optarg, nullptr, 10) * 1000 + 999;
+                break;
+            case 'c':
+                outPath = optarg;
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        usage();
+        return 1;
+    }
+
+    if (outPath != nullptr)
+    {
+        if (!exporter.openFile(outPath))
+        {
+            fprintf(stderr, "pstelemetry: unable to create %s\n", outPath);
+            return 1;
+        }
+    }
+    else
+        printHeader();
+
+    int rc = 0;
+    size_t extLen = strlen(PS_EXPORT_EXT);
+    for (int i = optind; i < argc; i++)
+    {
+        size_t len = strlen(argv[i]);
+        bool isExport = len > extLen && strcmp(argv[i] + len - extLen, PS_EXPORT_EXT) == 0;
+
+        if (!(isExport ? decodeExport(argv[i]) : decodeJournal(argv[i])))
+            rc = 1;
+    }
+
+    if (outPath != nullptr && !exporter.close())
+    {
+        fprintf(stderr, "pstelemetry: error writing %s\n", outPath);
+        rc = 1;
+    }
+
+    return rc;
+}
@@ -0,0 +1,178 @@
+/***************************************************************
+*  Program:      psuhid.cpp
+*  Version:      20261019
+*  Author:       Sifan S. Kahale
+*  Description:  Virtual Power*Star on the Linux HID stack
+*
+*  Creates a HID device with the Power*Star VID/PID through
+*  /dev/uhid and answers its 3 byte commands from the emulator,
+*  so an unmodified indi_powerstar built against hidapi-hidraw
+*  can be exercised end to end without a hub.
+*
+*  Usage: psuhid [emulator settings]
+*     settings are the same as PS_EMULATE (see PSemulator.h),
+*     the default only adds the hub's own processing time
+*  Needs write access to /dev/uhid (usually root).
+****************************************************************/
+
+#include "PSemulator.h"
+#include "PStransport.h"
+#include <linux/uhid.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <thread>
+
+using namespace std;
+
+// vendor page, one 3 byte input and one 3 byte output report, no report ids
+static const uint8_t reportDesc[] = {
+    0x06, 0x00, 0xff,       // Usage Page (Vendor Defined 0xFF00)
+    0x09, 0x01,             // Usage (0x01)
+    0xa1, 0x01,             // Collection (Application)
+    0x15, 0x00,             //   Logical Minimum (0)
+    0x26, 0xff, 0x00,       //   Logical Maximum (255)
+    0x75, 0x08,             //   Report Size (8)
+    0x95, 0x03,             //   Report Count (3)
+    0x09, 0x01,             //   Usage (0x01)
+    0x81, 0x02,             //   Input (Data,Var,Abs)
+    0x95, 0x03,             //   Report Count (3)
+    0x09, 0x01,             //   Usage (0x01)
+    0x91, 0x02,             //   Output (Data,Var,Abs)
+    0xc0                    // End Collection
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int)
+{
+    running = 0;
+}
+
+//******************************************************************
+static bool sendEvent(int fd, const struct uhid_event &ev)
+{
+    return write(fd, &ev, sizeof(ev)) == (ssize_t)sizeof(ev);
+}
+
+//******************************************************************
+static bool createDevice(int fd)
+{
+    struct uhid_event ev;
+    memset(&ev, 0, sizeof(ev));
+
+    ev.type = UHID_CREATE2;
+    strncpy((char *)ev.u.create2.name, "Power*Star (psuhid)", sizeof(ev.u.create2.name) - 1);
+    memcpy(ev.u.create2.rd_data, reportDesc, sizeof(reportDesc));
+    ev.u.create2.rd_size = sizeof(reportDesc);
+    ev.u.create2.bus = BUS_USB;
+    ev.u.create2.vendor = PS_VID;
+    ev.u.create2.product = PS_PID;
+
+    return sendEvent(fd, ev);
+}
+
+//******************************************************************
+static void reply(int fd, PSEmulator &emu, const uint8_t *data, uint16_t size)
+{
+    struct uhid_event ev;
+    memset(&ev, 0, sizeof(ev));
+
+    uint32_t us = emu.command(data, size, ev.u.input2.data);
+    this_thread::sleep_for(chrono::microseconds(us));
+
+    ev.type = UHID_INPUT2;
+    ev.u.input2.size = 3;
+    sendEvent(fd, ev);
+}
+
+//******************************************************************
+int main(int argc, char *argv[])
+{
+    PSEmulator &emu = psEmulator();
+    emu.configure("latency=300,jitter=100,open=0");
+    if (argc > 1)
+        emu.configure(argv[1]);
+
+    int fd = open("/dev/uhid", O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        fprintf(stderr, "psuhid: cannot open /dev/uhid: %s\n", strerror(errno));
+        return 1;
+    }
+
+    if (!createDevice(fd))
+    {
+        fprintf(stderr, "psuhid: cannot create device: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    fprintf(stderr, "psuhid: virtual Power*Star %04x:%04x running\n", PS_VID, PS_PID);
+
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    while (running)
+    {
+        if (poll(&pfd, 1, 500) <= 0)
+            continue;
+
+        struct uhid_event ev;
+        ssize_t n = read(fd, &ev, sizeof(ev));
+        if (n <= 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        switch (ev.type)
+        {
+            case UHID_OUTPUT:
+                if (ev.u.output.size > 0)
+                    reply(fd, emu, ev.u.output.data, ev.u.output.size);
+                break;
+
+            case UHID_GET_REPORT:
+            {
+                // feature reports are not part of the protocol
+                struct uhid_event rep;
+                memset(&rep, 0, sizeof(rep));
+                rep.type = UHID_GET_REPORT_REPLY;
+                rep.u.get_report_reply.id = ev.u.get_report.id;
+                rep.u.get_report_reply.err = EIO;
+                sendEvent(fd, rep);
+                break;
+            }
+
+            case UHID_SET_REPORT:
+            {
+                struct uhid_event rep;
+                memset(&rep, 0, sizeof(rep));
+                rep.type = UHID_SET_REPORT_REPLY;
+                rep.u.set_report_reply.id = ev.u.set_report.id;
+                rep.u.set_report_reply.err = EIO;
+                sendEvent(fd, rep);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    struct uhid_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_DESTROY;
+    sendEvent(fd, ev);
+    close(fd);
+
+    fprintf(stderr, "psuhid: %u commands answered\n", emu.commandCount());
+    return 0;
+}
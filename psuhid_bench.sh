@@ -0,0 +1,79 @@
+#!/bin/bash
+#***************************************************************
+#  Program:      psuhid_bench.sh
+#  Version:      20261019
+#  Author:       Sifan S. Kahale
+#  Description:  Run indi_powerstar under indiserver against the
+#                psuhid virtual Power*Star
+#
+#  Usage: psuhid_bench.sh [build dir] [seconds] [psuhid settings]
+#     build dir must hold psuhid and an indi_powerstar configured
+#     with -DPOWERSTAR_HIDRAW=ON (libusb can't see a uhid device)
+#  Needs root (or write access to /dev/uhid and the new hidraw node)
+#***************************************************************
+
+BUILD=${1:-build}
+SECONDS_TO_RUN=${2:-60}
+SETTINGS=${3:-}
+PORT=${PS_BENCH_PORT:-7625}
+DEVICE="Power*Star"
+LOG=$(mktemp -d /tmp/psuhid_bench.XXXXXX)
+
+UHID_PID=""
+SERVER_PID=""
+
+cleanup()
+{
+    [ -n "$SERVER_PID" ] && kill $SERVER_PID 2>/dev/null
+    [ -n "$UHID_PID" ] && kill $UHID_PID 2>/dev/null
+    wait 2>/dev/null
+}
+trap cleanup EXIT
+
+for prog in "$BUILD/psuhid" "$BUILD/indi_powerstar"; do
+    if [ ! -x "$prog" ]; then
+        echo "psuhid_bench: $prog not found, build first" >&2
+        exit 1
+    fi
+done
+
+modprobe uhid 2>/dev/null
+
+# virtual hub
+"$BUILD/psuhid" $SETTINGS 2> "$LOG/psuhid.log" &
+UHID_PID=$!
+
+# wait for the kernel to publish its hidraw node
+for i in $(seq 1 50); do
+    if grep -qs "HID_ID=0003:000004D8:0000EC42" /sys/class/hidraw/*/device/uevent; then
+        break
+    fi
+    sleep 0.1
+done
+if ! grep -qs "HID_ID=0003:000004D8:0000EC42" /sys/class/hidraw/*/device/uevent; then
+    echo "psuhid_bench: virtual Power*Star did not appear" >&2
+    cat "$LOG/psuhid.log" >&2
+    exit 1
+fi
+
+# driver
+PATH="$BUILD:$PATH" indiserver -p $PORT indi_powerstar > "$LOG/indiserver.log" 2>&1 &
+SERVER_PID=$!
+sleep 2
+
+indi_setprop -p $PORT "$DEVICE.CONNECTION.CONNECT=On"
+echo "psuhid_bench: running for $SECONDS_TO_RUN s, logs in $LOG"
+sleep $SECONDS_TO_RUN
+
+indi_getprop -p $PORT "$DEVICE.POWER_SENSORS.*"
+indi_setprop -p $PORT "$DEVICE.CONNECTION.DISCONNECT=On"
+sleep 1
+
+cleanup
+UHID_PID=""
+SERVER_PID=""
+
+COMMANDS=$(sed -n 's/^psuhid: \([0-9]*\) commands answered/\1/p' "$LOG/psuhid.log")
+if [ -n "$COMMANDS" ]; then
+    echo "psuhid_bench: $COMMANDS commands in $SECONDS_TO_RUN s ($((COMMANDS / SECONDS_TO_RUN)) per second)"
+fi